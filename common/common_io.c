@@ -37,7 +37,7 @@ void __genericPrintFormat(void (*printChar)(char), void (*printString)(char*), c
                 break;
 
 			case 'o': // Inserts an unsigned octal integer
-                printString(itoa(*((int*)args), buffer, 8));
+                printString(utoa(*((uint32_t*)args), buffer, 8));
                 args++;
                 break;
 
@@ -46,8 +46,13 @@ void __genericPrintFormat(void (*printChar)(char), void (*printString)(char*), c
                 args++;
                 break;
 
+            case 'u': // Inserts an unsigned integer
+                printString(utoa(*((uint32_t*)args), buffer, 10));
+                args++;
+                break;
+
             case 'x': // Inserts an unsigned hexadecimal integer
-				printString(itoa(*((int*)args), buffer, 16));
+				printString(utoa(*((uint32_t*)args), buffer, 16));
                 args++;
                 break;
 
@@ -64,6 +64,21 @@ extern int strcmp(const char *str1, const char *str2)
     return 0;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+char *strncpy(char *dst, const char *src, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i < n && src[i] != '\0'; i++)
+    {
+        dst[i] = src[i];
+    }
+    for (; i < n; i++)
+    {
+        dst[i] = '\0';
+    }
+    return dst;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 uint32_t strlen(const char *str)
 {
@@ -158,3 +173,34 @@ char* itoa(int value, char *str, int base)
 	}
 	return str;
 }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+char* utoa(uint32_t value, char *str, int base)
+{
+	// Do not handle bases that are not between 2 and 36 included
+	if (base < 2 || base > 36)
+	{
+		str[0] = '\0';
+		return str;
+	}
+
+	char digits[32];
+	int cursor = 0;
+
+	// Stacks the digits starting with the unit
+	do {
+		digits[cursor++] = value % base;
+		value /= base;
+	} while (value > 0);
+
+	// Put each digit in the string
+	char *strCursor = str;
+	while (cursor > 0)
+	{
+		char digit = digits[--cursor];
+		*strCursor++ = digit < 10 ? 48 + digit : 55 + digit;
+	}
+	*strCursor = '\0';
+
+	return str;
+}
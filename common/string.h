@@ -61,6 +61,22 @@ extern int strncmp(const char *p, const char *q, uint32_t n);
 
 extern int strcmp(const char *str1, const char *str2);
 
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn char *strncpy(char *dst, const char *src, uint32_t n)
+/// \brief Copies up to n characters of a string.
+///
+/// Copies the C string src into dst, stopping after n characters. If src is shorter
+/// than n characters, dst is padded with null characters up to n. As with the standard
+/// function, dst isn't null-terminated if src is n characters long or more.
+///
+/// \param dst : Destination buffer (at least n bytes).
+/// \param src : C string to be copied.
+/// \param n : Maximum number of characters to copy.
+///
+/// \return dst is returned.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern char *strncpy(char *dst, const char *src, uint32_t n);
+
 extern uint32_t strlen(const char *str);
 
 extern void split(char* str, char c, char* tab_str, int nb_str, int size_str);
@@ -69,4 +85,18 @@ extern int atoi(char *s);
 
 extern char* itoa(int value, char *str, int base);
 
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn char* utoa(uint32_t value, char *str, int base)
+/// \brief Converts an unsigned integer to a string.
+///
+/// Same as itoa but the value is always interpreted as unsigned, in any base.
+///
+/// \param value : Value to be converted.
+/// \param str : Buffer where the string is stored (33 bytes are enough for any base).
+/// \param base : Base between 2 and 36 included.
+///
+/// \return str is returned.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern char* utoa(uint32_t value, char *str, int base);
+
 #endif
@@ -15,8 +15,49 @@ typedef enum {
     SYSCALL_SLEEP,
     SYSCALL_CLEAR_SCREEN,
     SYSCALL_SET_CURSOR,
+    SYSCALL_PROFILER,
+    SYSCALL_TRACE_DUMP,
+    SYSCALL_MEM_STATS,
+    SYSCALL_BRK,
+    SYSCALL_FORK,
+    SYSCALL_LOCK_STATS,
+    SYSCALL_READ_LINE,
+    SYSCALL_IRQ_STATS,
+    SYSCALL_LATENCY_STATS,
+    SYSCALL_GET_TSC_KHZ,
+    SYSCALL_PORT_CREATE,
+    SYSCALL_PORT_SEND,
+    SYSCALL_PORT_RECEIVE,
+    SYSCALL_PORT_REPLY,
+    SYSCALL_PIPE_CREATE,
+    SYSCALL_PIPE_CLOSE,
+    SYSCALL_PIPE_REDIRECT,
+    SYSCALL_READ,
+    SYSCALL_WRITE,
+    SYSCALL_WAIT,
+    SYSCALL_SHM_CREATE,
+    SYSCALL_SHM_MAP,
 
     __SYSCALL_END__
 } syscall_t;
 
+// Commands accepted by the SYSCALL_PROFILER system call
+typedef enum {
+    PROFILER_START = 0,
+    PROFILER_STOP,
+    PROFILER_RESET,
+    PROFILER_DUMP
+} profiler_cmd_t;
+
+// Pages of an IPC message: the address of the first page in the task memory, page
+// aligned, with the number of pages in its low bits
+#define IPC_PAGE_SIZE               4096
+#define IPC_PAGES(address, count)   ((address) | (count))
+#define IPC_PAGES_ADDRESS(pages)    ((pages) & ~(IPC_PAGE_SIZE - 1))
+#define IPC_PAGES_COUNT(pages)      ((pages) & (IPC_PAGE_SIZE - 1))
+
+// Pipe of the SYSCALL_PIPE_REDIRECT system call connecting a task to the keyboard or to
+// the screen
+#define PIPE_CONSOLE                (-1)
+
 #endif
@@ -9,7 +9,9 @@ typedef unsigned short ushort;
 typedef unsigned int uint;
 typedef unsigned long ulong;
 
+#ifndef NULL
 #define NULL 0
+#endif
 
 #endif
 
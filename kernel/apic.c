@@ -0,0 +1,497 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file apic.c
+/// \brief Implementation of the local APIC and I/O APIC functions.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "apic.h"
+
+#include "idt.h"
+#include "paging.h"
+#include "pic.h"
+#include "smp.h"
+#include "timer.h"
+#include "x86.h"
+#include "../common/string.h"
+
+#define NB_ISA_IRQS             16
+#define IRQ_FIRST_VECTOR        32          // Vector of IRQ 0, same as the PIC (see pic.c)
+#define IRQ_CASCADE             2           // Slave PIC, never raised on the I/O APIC
+
+// Areas searched for the ACPI and MP pointers
+#define EBDA_SEGMENT_POINTER    0x40E       // Segment of the extended BIOS data area
+#define EBDA_SEARCH_SIZE        1024
+#define BIOS_AREA_START         0xE0000
+#define BIOS_AREA_END           0x100000
+
+// Entries of the ACPI MADT
+#define MADT_LOCAL_APIC         0
+#define MADT_IO_APIC            1
+#define MADT_OVERRIDE           2           // ISA IRQ connected to another I/O APIC input
+#define MADT_ENABLED            0x1
+
+// Entries of the MP configuration table
+#define MP_PROCESSOR            0
+#define MP_BUS                  1
+#define MP_IO_APIC              2
+#define MP_IO_INTERRUPT         3
+#define MP_PROCESSOR_SIZE       20
+#define MP_ENTRY_SIZE           8
+#define MP_ENABLED              0x1
+#define MP_INTERRUPT_INT        0           // Vectored interrupt, routed by the I/O APIC
+
+// Polarity and trigger mode of the MADT overrides and MP interrupts
+#define FLAGS_POLARITY_MASK     0x3
+#define FLAGS_ACTIVE_LOW        0x3
+#define FLAGS_TRIGGER_MASK      0xC
+#define FLAGS_LEVEL             0xC
+
+// CPUID leaf 1, EDX
+#define CPUID_APIC              (1 << 9)
+
+// Registers of the local APIC, offsets from its base address
+#define LAPIC_ID                0x020
+#define LAPIC_EOI               0x0B0
+#define LAPIC_SVR               0x0F0       // Spurious interrupt vector register
+#define LAPIC_ICR_LOW           0x300       // Interrupt command register
+#define LAPIC_ICR_HIGH          0x310
+#define LAPIC_LVT_TIMER         0x320
+#define LAPIC_TIMER_INITIAL     0x380
+#define LAPIC_TIMER_CURRENT     0x390
+#define LAPIC_TIMER_DIVIDE      0x3E0
+
+#define LAPIC_SVR_ENABLE        0x100
+#define LAPIC_ICR_PENDING       0x1000      // Delivery status
+#define LAPIC_LVT_MASKED        0x10000
+#define LAPIC_TIMER_PERIODIC    0x20000
+#define LAPIC_TIMER_DIVIDE_16   0x3
+
+// Registers of the I/O APIC, selected by IOREGSEL and accessed through IOWIN
+#define IOAPIC_IOREGSEL         0x00
+#define IOAPIC_IOWIN            0x10
+#define IOAPIC_VERSION          0x01        // Bits 16-23: last redirection entry
+#define IOAPIC_REDIRECTION      0x10        // Two registers per input
+
+#define IOAPIC_ACTIVE_LOW       0x2000
+#define IOAPIC_LEVEL            0x8000
+#define IOAPIC_MASKED           0x10000
+
+#define TIMER_CALIBRATION_TICKS 10          // PIT ticks
+
+typedef struct __attribute__((packed)) acpi_rsdp_st {
+    char     signature[8];          // "RSD PTR "
+    uint8_t  checksum;
+    char     oem[6];
+    uint8_t  revision;
+    uint32_t rsdt;
+} acpi_rsdp_t;
+
+typedef struct __attribute__((packed)) acpi_header_st {
+    char     signature[4];
+    uint32_t length;                // Header included
+    uint8_t  revision;
+    uint8_t  checksum;
+    char     oem[6];
+    char     oem_table[8];
+    uint32_t oem_revision;
+    uint32_t creator;
+    uint32_t creator_revision;
+} acpi_header_t;
+
+// The entries follow the structure, each one starts with its type and its length
+typedef struct __attribute__((packed)) acpi_madt_st {
+    acpi_header_t header;           // "APIC"
+    uint32_t lapic;                 // Address of the local APICs
+    uint32_t flags;
+} acpi_madt_t;
+
+typedef struct __attribute__((packed)) mp_floating_st {
+    char     signature[4];          // "_MP_"
+    uint32_t config;                // Address of the configuration table
+    uint8_t  length;                // In 16 bytes units
+    uint8_t  revision;
+    uint8_t  checksum;
+    uint8_t  features[5];
+} mp_floating_t;
+
+// The entries follow the structure, the processors take 20 bytes and the others 8
+typedef struct __attribute__((packed)) mp_config_st {
+    char     signature[4];          // "PCMP"
+    uint16_t length;
+    uint8_t  revision;
+    uint8_t  checksum;
+    char     oem[8];
+    char     product[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t nb_entries;
+    uint32_t lapic;                 // Address of the local APICs
+    uint16_t extended_length;
+    uint8_t  extended_checksum;
+    uint8_t  reserved;
+} mp_config_t;
+
+// Input of the I/O APIC of an ISA IRQ
+typedef struct isa_route_st {
+    uint32_t input;
+    uint32_t flags;                 // FLAGS_xxx, 0 for the ISA defaults (edge, active high)
+} isa_route_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static volatile uint32_t *lapic = NULL;
+static volatile uint32_t *ioapic = NULL;
+static bool enabled = false;
+
+static uint32_t lapic_address = 0;
+static uint32_t ioapic_address = 0;
+static isa_route_t isa_routes[NB_ISA_IRQS];
+
+// Local APIC identifiers of the enabled processors found in the tables
+static uint32_t apic_ids[MAX_NB_CPUS];
+static uint32_t nb_apic_ids = 0;
+
+static uint32_t timer_initial_count = 0;    // Count of one tick, measured by the first call
+static volatile uint32_t timer_ticks[MAX_NB_CPUS];
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+static uint32_t lapic_read(uint32_t reg)
+{
+    return lapic[reg / sizeof(uint32_t)];
+}
+
+static void lapic_write(uint32_t reg, uint32_t value)
+{
+    lapic[reg / sizeof(uint32_t)] = value;
+}
+
+static uint32_t ioapic_read(uint32_t reg)
+{
+    ioapic[IOAPIC_IOREGSEL / sizeof(uint32_t)] = reg;
+    return ioapic[IOAPIC_IOWIN / sizeof(uint32_t)];
+}
+
+static void ioapic_write(uint32_t reg, uint32_t value)
+{
+    ioapic[IOAPIC_IOREGSEL / sizeof(uint32_t)] = reg;
+    ioapic[IOAPIC_IOWIN / sizeof(uint32_t)] = value;
+}
+
+static bool checksum_ok(uint8_t *bytes, uint32_t length)
+{
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+// Searches a structure starting with signature on a 16 bytes boundary of [start, end[.
+static void* scan(uint32_t start, uint32_t end, const char *signature, uint32_t length)
+{
+    for (uint32_t address = start; address + length <= end; address += 16)
+    {
+        if (strncmp((char*)address, signature, strlen(signature)) == 0
+            && checksum_ok((uint8_t*)address, length))
+        {
+            return (void*)address;
+        }
+    }
+    return NULL;
+}
+
+// Searches a BIOS structure in the extended BIOS data area, then in the BIOS ROM.
+static void* find_bios_structure(const char *signature, uint32_t length)
+{
+    uint32_t ebda = *(volatile uint16_t*)EBDA_SEGMENT_POINTER << 4;
+    void *structure = NULL;
+    if (ebda != 0)
+    {
+        structure = scan(ebda, ebda + EBDA_SEARCH_SIZE, signature, length);
+    }
+    if (structure == NULL)
+    {
+        structure = scan(BIOS_AREA_START, BIOS_AREA_END, signature, length);
+    }
+    return structure;
+}
+
+static void add_processor(uint32_t apic_id)
+{
+    if (nb_apic_ids < MAX_NB_CPUS)
+    {
+        apic_ids[nb_apic_ids++] = apic_id;
+    }
+}
+
+// Reads the processors, the first I/O APIC and the ISA overrides of the ACPI MADT table.
+// Returns false if there is no table.
+static bool parse_madt()
+{
+    acpi_rsdp_t *rsdp = find_bios_structure("RSD PTR ", sizeof(acpi_rsdp_t));
+    if (rsdp == NULL || rsdp->rsdt >= PAGING_IDENTITY_SIZE)
+    {
+        return false;
+    }
+
+    acpi_header_t *rsdt = (acpi_header_t*)rsdp->rsdt;
+    uint32_t *tables = (uint32_t*)(rsdt + 1);
+    uint32_t nb_tables = (rsdt->length - sizeof(acpi_header_t)) / sizeof(uint32_t);
+    for (uint32_t i = 0; i < nb_tables; i++)
+    {
+        acpi_madt_t *madt = (acpi_madt_t*)tables[i];
+        if (tables[i] >= PAGING_IDENTITY_SIZE || strncmp(madt->header.signature, "APIC", 4) != 0)
+        {
+            continue;
+        }
+
+        lapic_address = madt->lapic;
+        uint8_t *end = (uint8_t*)madt + madt->header.length;
+        for (uint8_t *entry = (uint8_t*)(madt + 1); entry < end && entry[1] != 0; entry += entry[1])
+        {
+            if (entry[0] == MADT_LOCAL_APIC && (entry[4] & MADT_ENABLED))
+            {
+                add_processor(entry[3]);
+            }
+            // Only the I/O APIC of the first inputs (global interrupt 0) is used
+            else if (entry[0] == MADT_IO_APIC && *(uint32_t*)(entry + 8) == 0)
+            {
+                ioapic_address = *(uint32_t*)(entry + 4);
+            }
+            else if (entry[0] == MADT_OVERRIDE && entry[3] < NB_ISA_IRQS)
+            {
+                isa_routes[entry[3]].input = *(uint32_t*)(entry + 4);
+                isa_routes[entry[3]].flags = *(uint16_t*)(entry + 8);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// Reads the processors, the first I/O APIC and the ISA interrupts of the MP configuration
+// table. Returns false if there is no table.
+static bool parse_mp_tables()
+{
+    mp_floating_t *floating = find_bios_structure("_MP_", sizeof(mp_floating_t));
+    if (floating == NULL || floating->config == 0 || floating->config >= PAGING_IDENTITY_SIZE)
+    {
+        return false;
+    }
+
+    mp_config_t *config = (mp_config_t*)floating->config;
+    if (strncmp(config->signature, "PCMP", 4) != 0)
+    {
+        return false;
+    }
+
+    lapic_address = config->lapic;
+    int isa_bus = -1;
+    int ioapic_id = -1;
+    uint8_t *entry = (uint8_t*)(config + 1);
+    for (uint32_t i = 0; i < config->nb_entries; i++)
+    {
+        if (entry[0] == MP_PROCESSOR)
+        {
+            if (entry[3] & MP_ENABLED)
+            {
+                add_processor(entry[1]);
+            }
+            entry += MP_PROCESSOR_SIZE;
+            continue;
+        }
+
+        if (entry[0] == MP_BUS && strncmp((char*)entry + 2, "ISA", 3) == 0)
+        {
+            isa_bus = entry[1];
+        }
+        else if (entry[0] == MP_IO_APIC && (entry[3] & MP_ENABLED) && ioapic_id == -1)
+        {
+            ioapic_id = entry[1];
+            ioapic_address = *(uint32_t*)(entry + 4);
+        }
+        // The buses and the I/O APICs are listed before the interrupts
+        else if (entry[0] == MP_IO_INTERRUPT && entry[1] == MP_INTERRUPT_INT
+                 && entry[4] == isa_bus && entry[6] == ioapic_id && entry[5] < NB_ISA_IRQS)
+        {
+            isa_routes[entry[5]].input = entry[7];
+            isa_routes[entry[5]].flags = *(uint16_t*)(entry + 2);
+        }
+        entry += MP_ENTRY_SIZE;
+    }
+    return true;
+}
+
+static bool cpu_has_apic()
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    return (edx & CPUID_APIC) != 0;
+}
+
+// Routes the ISA IRQs to the bootstrap processor, on the vectors of the PIC.
+static void route_isa_irqs()
+{
+    uint32_t nb_inputs = ((ioapic_read(IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+
+    for (uint32_t irq = 0; irq < NB_ISA_IRQS; irq++)
+    {
+        isa_route_t *route = &isa_routes[irq];
+        if (route->input >= nb_inputs || (irq == IRQ_CASCADE && route->input == IRQ_CASCADE))
+        {
+            continue;
+        }
+
+        uint32_t low = IRQ_FIRST_VECTOR + irq;
+        if ((route->flags & FLAGS_POLARITY_MASK) == FLAGS_ACTIVE_LOW)
+        {
+            low |= IOAPIC_ACTIVE_LOW;
+        }
+        if ((route->flags & FLAGS_TRIGGER_MASK) == FLAGS_LEVEL)
+        {
+            low |= IOAPIC_LEVEL;
+        }
+        ioapic_write(IOAPIC_REDIRECTION + route->input * 2 + 1, lapic_id() << 24);
+        ioapic_write(IOAPIC_REDIRECTION + route->input * 2, low);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void apic_init()
+{
+    for (uint32_t irq = 0; irq < NB_ISA_IRQS; irq++)
+    {
+        isa_routes[irq].input = irq;
+        isa_routes[irq].flags = 0;
+    }
+
+    if (!cpu_has_apic() || (!parse_madt() && !parse_mp_tables())
+        || lapic_address < PAGING_DEVICE_BASE)
+    {
+        nb_apic_ids = 0;
+        return;
+    }
+
+    paging_map_device(lapic_address);
+    lapic = (uint32_t*)lapic_address;
+    lapic_enable();
+
+    // The processors and the local APIC timers are used either way, only the IRQs stay
+    // on the PIC with NO_APIC or without I/O APIC
+    #ifdef NO_APIC
+    return;
+    #endif
+    if (ioapic_address < PAGING_DEVICE_BASE)
+    {
+        return;
+    }
+    paging_map_device(ioapic_address);
+    ioapic = (uint32_t*)ioapic_address;
+
+    pic_disable();
+    route_isa_irqs();
+    enabled = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+bool apic_enabled()
+{
+    return enabled;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void apic_eoi(int irq)
+{
+    if (enabled)
+    {
+        lapic_eoi();
+    }
+    else
+    {
+        pic_eoi(irq);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t apic_nb_processors()
+{
+    return nb_apic_ids;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t apic_processor(uint32_t index)
+{
+    return apic_ids[index];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t lapic_id()
+{
+    return lapic == NULL ? 0 : lapic_read(LAPIC_ID) >> 24;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void lapic_enable()
+{
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | IDT_SPURIOUS_VECTOR);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void lapic_send_ipi(uint32_t apic_id, uint32_t command)
+{
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING)
+    {
+        cpu_relax();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void lapic_eoi()
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void apic_timer_init()
+{
+    if (lapic == NULL)
+    {
+        return;
+    }
+
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+
+    // Counts down from the maximum during a few PIT ticks, synchronized on a tick edge
+    if (timer_initial_count == 0)
+    {
+        lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+        uint32_t start = get_ticks();
+        while (start == get_ticks());
+
+        lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+        start = get_ticks();
+        while (get_ticks() - start < TIMER_CALIBRATION_TICKS);
+        uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+
+        // Count of 1 PIT tick, then of 1 APIC timer tick
+        timer_initial_count = elapsed / TIMER_CALIBRATION_TICKS * get_timer_freq() / APIC_TIMER_HZ;
+    }
+
+    lapic_write(LAPIC_LVT_TIMER, APIC_TIMER_VECTOR | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_TIMER_INITIAL, timer_initial_count);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void apic_timer_handler()
+{
+    timer_ticks[smp_cpu_id()]++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t apic_timer_ticks(uint32_t cpu)
+{
+    return timer_ticks[cpu];
+}
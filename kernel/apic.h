@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file apic.h
+/// \brief Declaration of the local APIC and I/O APIC functions.
+///
+/// The APICs are described by the ACPI MADT table, or by the MP tables of older BIOSes.
+/// When both a local APIC and an I/O APIC are found, the ISA IRQs are routed by the I/O
+/// APIC to the bootstrap processor on the vectors used by the 8259 PIC (32 to 47), the
+/// PIC is masked and the interrupts are acknowledged with a write to the local APIC
+/// instead of port I/O. Otherwise the PIC stays in use. Compiling with NO_APIC (make
+/// APIC=0) keeps the IRQs on the PIC, to compare both paths: the tables are still read
+/// and the local APIC still started, for the application processors and the timers.
+///
+/// Each processor also has its own local APIC timer, calibrated against the PIT.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _APIC_H_
+#define _APIC_H_
+
+#include "../common/types.h"
+
+#define APIC_TIMER_IRQ          16      // IRQ number given to the local APIC timer
+#define APIC_TIMER_VECTOR       49      // After the system call gate
+#define APIC_TIMER_HZ           100
+
+// Commands of lapic_send_ipi()
+#define LAPIC_ICR_INIT          0x00004500  // INIT, level assert
+#define LAPIC_ICR_STARTUP       0x00004600  // Startup IPI, vector = page of the code
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void apic_init()
+/// \brief Finds the APICs, enables the local APIC of the bootstrap processor and routes
+///        the ISA IRQs through the I/O APIC. Called with the interruptions disabled.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void apic_init();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool apic_enabled()
+/// \brief Returns whether the IRQs go through the APICs rather than the PIC.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern bool apic_enabled();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void apic_eoi(int irq)
+/// \brief Acknowledges an IRQ to the local APIC, or to the PIC without APIC.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void apic_eoi(int irq);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t apic_nb_processors()
+/// \brief Returns the number of enabled processors listed by the tables, 0 if there is
+///        no usable local APIC.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t apic_nb_processors();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t apic_processor(uint32_t index)
+/// \brief Returns the local APIC identifier of a processor listed by the tables.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t apic_processor(uint32_t index);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t lapic_id()
+/// \brief Returns the identifier of the local APIC of the calling processor.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t lapic_id();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void lapic_enable()
+/// \brief Enables the local APIC of the calling processor.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void lapic_enable();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void lapic_send_ipi(uint32_t apic_id, uint32_t command)
+/// \brief Sends an inter-processor interrupt and waits until it is delivered.
+/// \param apic_id : Local APIC of the destination processor.
+/// \param command : Low word of the interrupt command register (LAPIC_ICR_xxx).
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void lapic_send_ipi(uint32_t apic_id, uint32_t command);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void lapic_eoi()
+/// \brief Acknowledges the interrupt in service on the local APIC.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void lapic_eoi();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void apic_timer_init()
+/// \brief Starts the local APIC timer of the calling processor at APIC_TIMER_HZ.
+///
+/// The first call measures the frequency of the timer against the PIT, which takes 10
+/// ticks: interruptions must be enabled.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void apic_timer_init();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void apic_timer_handler()
+/// \brief Interruption routine of the local APIC timers, counts the ticks of each
+///        processor.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void apic_timer_handler();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t apic_timer_ticks(uint32_t cpu)
+/// \brief Returns the ticks of the local APIC timer of a processor (see smp.h).
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t apic_timer_ticks(uint32_t cpu);
+
+#endif
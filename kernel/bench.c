@@ -0,0 +1,322 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file bench.c
+/// \brief Implementation of the benchmark functions.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "bench.h"
+
+#include "apic.h"
+#include "gdt.h"
+#include "ide.h"
+#include "idt.h"
+#include "irq.h"
+#include "latency.h"
+#include "io.h"
+#include "periph.h"
+#include "pic.h"
+#include "pfs.h"
+#include "ring.h"
+#include "serial.h"
+#include "smp.h"
+#include "sync.h"
+#include "timer.h"
+#include "x86.h"
+#include "../common/string.h"
+#include "../common/syscall_nb.h"
+
+#define SECTOR_READ_ITERATIONS  256
+#define FILE_READ_ITERATIONS    8
+#define FIND_FILE_ITERATIONS    64
+#define SYSCALL_ITERATIONS      10000
+#define EXEC_ITERATIONS         32
+#define PRINT_ITERATIONS        2000
+#define MEMCPY_ITERATIONS       64
+#define MEMCPY_SIZE             0x10000
+#define FILE_BUFFER_SIZE        0x100000
+#define EOI_ITERATIONS          10000
+#define IRQ_SAMPLE_MS           1000
+#define LOCK_ITERATIONS         100000
+#define RING_ITERATIONS         10000
+#define RING_CHUNK              64
+#define LOCK_CPU_ITERATIONS     10000
+
+// Program executed by the context switch benchmark (user/app.c, returns immediately)
+#define EMPTY_PROGRAM           "app"
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static uint8_t file_buffer[FILE_BUFFER_SIZE];
+static uint8_t memcpy_src[MEMCPY_SIZE];
+static uint8_t memcpy_dst[MEMCPY_SIZE];
+static spinlock_t bench_lock;
+static uint8_t ring_buffer[1024];
+static volatile uint32_t bench_counter;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Prints the result of a benchmark.
+static void report(char *name, uint32_t iterations, uint64_t cycles)
+{
+    printf("BENCH %s %u %u\n", name, iterations, div64(cycles, iterations));
+}
+
+static void bench_sector_read()
+{
+    uint8_t buffer[SECTOR_SIZE];
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < SECTOR_READ_ITERATIONS; i++)
+    {
+        read_sector(i, buffer);
+    }
+    report("sector_read", SECTOR_READ_ITERATIONS, rdtsc() - start);
+}
+
+static void bench_file_read(char *file_name)
+{
+    char name[48] = "file_read_";
+    stat_t stat;
+
+    if (file_stat(file_name, &stat) == -1 || stat.size > sizeof(file_buffer))
+    {
+        printf("# file_read: %s not found or too big\n", file_name);
+        return;
+    }
+    strncpy(name + strlen(name), file_name, sizeof(name) - strlen(name) - 1);
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < FILE_READ_ITERATIONS; i++)
+    {
+        file_read(file_name, file_buffer);
+    }
+    report(name, FILE_READ_ITERATIONS, rdtsc() - start);
+    printf("# %s size=%u\n", name, stat.size);
+}
+
+static void bench_find_file(char *bench_name, char *file_name)
+{
+    uint64_t start = rdtsc();
+    for (int i = 0; i < FIND_FILE_ITERATIONS; i++)
+    {
+        find_file(file_name);
+    }
+    report(bench_name, FIND_FILE_ITERATIONS, rdtsc() - start);
+}
+
+// Round trip through the system call gate, with the cheapest system call.
+static void bench_syscall()
+{
+    uint32_t result;
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < SYSCALL_ITERATIONS; i++)
+    {
+        asm volatile("int $48" : "=a"(result) : "a"(SYSCALL_GET_TICKS) : "memory");
+    }
+    report("syscall_round_trip", SYSCALL_ITERATIONS, rdtsc() - start);
+}
+
+// Executes an empty program : loading it, switching to the task and back.
+static void bench_exec()
+{
+    if (!file_exists(EMPTY_PROGRAM))
+    {
+        printf("# exec: %s not found\n", EMPTY_PROGRAM);
+        return;
+    }
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < EXEC_ITERATIONS; i++)
+    {
+        exec_task(EMPTY_PROGRAM);
+    }
+    report("exec_empty_task", EXEC_ITERATIONS, rdtsc() - start);
+
+    // The same loading without the task switches
+    start = rdtsc();
+    for (int i = 0; i < EXEC_ITERATIONS; i++)
+    {
+        file_read(EMPTY_PROGRAM, file_buffer);
+    }
+    report("exec_empty_task_load", EXEC_ITERATIONS, rdtsc() - start);
+}
+
+// Prints full lines on the VGA display (scrolling included).
+static void bench_print()
+{
+    char line[TEXT_DISPLAY_COLUMNS];
+    memset(line, 'x', sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+
+    uint8_t outputs = get_console_output();
+    set_console_output(CONSOLE_VGA);
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < PRINT_ITERATIONS; i++)
+    {
+        print_str(line);
+        print_char('\n');
+    }
+    uint64_t cycles = rdtsc() - start;
+
+    set_console_output(outputs);
+    report("console_print_line", PRINT_ITERATIONS, cycles);
+}
+
+static void bench_memcpy()
+{
+    memset(memcpy_src, 0xA5, sizeof(memcpy_src));
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < MEMCPY_ITERATIONS; i++)
+    {
+        memcpy(memcpy_dst, memcpy_src, MEMCPY_SIZE);
+    }
+    report("memcpy_64k", MEMCPY_ITERATIONS, rdtsc() - start);
+}
+
+// Cost of acknowledging an IRQ on each controller, then of the whole timer IRQ handler
+// with the controller in use (see apic.h, make bench APIC=0 for the PIC).
+static void bench_irq()
+{
+    // Without interrupt in service, the EOIs have no effect
+    uint32_t flags = irq_save();
+    uint64_t start = rdtsc();
+    for (int i = 0; i < EOI_ITERATIONS; i++)
+    {
+        pic_eoi(0);
+    }
+    report("irq_eoi_pic", EOI_ITERATIONS, rdtsc() - start);
+
+    if (apic_enabled())
+    {
+        start = rdtsc();
+        for (int i = 0; i < EOI_ITERATIONS; i++)
+        {
+            lapic_eoi();
+        }
+        report("irq_eoi_lapic", EOI_ITERATIONS, rdtsc() - start);
+    }
+    irq_restore(flags);
+
+    irq_stats_t before, after;
+    irq_get_stats(0, &before);
+    sleep(IRQ_SAMPLE_MS);
+    irq_get_stats(0, &after);
+    if (after.count == before.count)
+    {
+        printf("# irq: no interrupt received\n");
+        return;
+    }
+    report(apic_enabled() ? "irq_entry_to_eoi_apic" : "irq_entry_to_eoi_pic",
+           after.count - before.count, after.total_cycles - before.total_cycles);
+    printf("# irq max=%u cycles\n", after.max_cycles);
+    irq_dump_stats();
+
+    #ifdef LATENCY
+    latency_dump();
+    #endif
+}
+
+// Passes chunks of bytes through a ring one byte at a time, then with the bulk copies.
+static void bench_ring()
+{
+    ring_t ring = RING_INIT(ring_buffer);
+    uint8_t chunk[RING_CHUNK];
+    memset(chunk, 'x', sizeof(chunk));
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < RING_ITERATIONS; i++)
+    {
+        for (int j = 0; j < RING_CHUNK; j++)
+        {
+            ring_put(&ring, chunk[j]);
+        }
+        for (int j = 0; j < RING_CHUNK; j++)
+        {
+            ring_get(&ring, &chunk[j]);
+        }
+    }
+    report("ring_64_bytes_single", RING_ITERATIONS, rdtsc() - start);
+
+    start = rdtsc();
+    for (int i = 0; i < RING_ITERATIONS; i++)
+    {
+        ring_write(&ring, chunk, RING_CHUNK);
+        ring_read(&ring, chunk, RING_CHUNK);
+    }
+    report("ring_64_bytes_bulk", RING_ITERATIONS, rdtsc() - start);
+}
+
+// Run by every processor in the contended lock benchmark, a short critical section.
+static void lock_loop(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < LOCK_CPU_ITERATIONS; i++)
+    {
+        uint32_t flags = spin_lock_irqsave(&bench_lock);
+        bench_counter++;
+        spin_unlock_irqrestore(&bench_lock, flags);
+    }
+}
+
+// Cost of the synchronization primitives, with and without contention. The lock
+// statistics show the wait and hold times of the kernel locks under the benchmarks.
+static void bench_locks()
+{
+    spinlock_init(&bench_lock, "bench");
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < LOCK_ITERATIONS; i++)
+    {
+        uint32_t flags = spin_lock_irqsave(&bench_lock);
+        bench_counter++;
+        spin_unlock_irqrestore(&bench_lock, flags);
+    }
+    report("spinlock_uncontended", LOCK_ITERATIONS, rdtsc() - start);
+
+    start = rdtsc();
+    for (int i = 0; i < LOCK_ITERATIONS; i++)
+    {
+        get_ticks64();
+    }
+    report("seqlock_read_ticks", LOCK_ITERATIONS, rdtsc() - start);
+
+    // Every processor takes the same lock
+    start = rdtsc();
+    smp_run_on_all(lock_loop, NULL);
+    report("spinlock_all_cpus", smp_nb_cpus() * LOCK_CPU_ITERATIONS, rdtsc() - start);
+    printf("# smp cpus=%u\n", smp_nb_cpus());
+    smp_dump_stats();
+
+    sync_dump_stats();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void runBenchmarks()
+{
+    // Results are only sent on the serial port
+    set_console_output(CONSOLE_SERIAL);
+    printf("# bench tsc_khz=%u\n", get_tsc_khz());
+
+    bench_sector_read();
+    bench_file_read("image.txt");
+    bench_file_read("tictactoe");
+    bench_file_read("shell");
+    bench_find_file("find_file_first", "shell");
+    bench_find_file("find_file_last", "tictactoejeu.txt");
+    bench_find_file("find_file_missing", "missing.txt");
+    bench_syscall();
+    bench_exec();
+    bench_print();
+    bench_memcpy();
+    bench_ring();
+    bench_irq();
+    bench_locks();
+
+    printf("# bench done\n");
+    serial_flush();
+
+    // Exits QEMU with status (0 << 1) | 1
+    outb(BENCH_EXIT_PORT, 0);
+}
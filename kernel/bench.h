@@ -0,0 +1,25 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file bench.h
+/// \brief Definition of the benchmark functions.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+// I/O port of QEMU's isa-debug-exit device (-device isa-debug-exit,iobase=0xf4)
+#define BENCH_EXIT_PORT 0xF4
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn extern void runBenchmarks()
+/// \brief Runs the benchmark suite and exits QEMU.
+///
+/// Each benchmark prints one line on the serial port :
+///
+///     BENCH <name> <iterations> <cycles per iteration>
+///
+/// Then QEMU is stopped through the isa-debug-exit device, with exit status 1 on
+/// success. Without that device, the CPU is halted.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void runBenchmarks();
+
+#endif
@@ -4,7 +4,7 @@ extern runKernel    ; Kernel main function
 
 ; Values for the multiboot header
 MULTIBOOT_HEADER_MAGIC     equ 0x1BADB002
-MULTIBOOT_HEADER_FLAGS     equ 0x0
+MULTIBOOT_HEADER_FLAGS     equ 0x2     ; ask for the memory information (bit 1)
 
 ; magic + checksum + flags must equal 0
 MULTIBOOT_HEADER_CHECKSUM  equ -(MULTIBOOT_HEADER_MAGIC + MULTIBOOT_HEADER_FLAGS)
@@ -32,7 +32,10 @@ entrypoint:
     add esp, STACK_SIZE
     mov ebp, esp
 
-    ; Calling the kernel main function
+    ; Calling the kernel main function with the multiboot magic value (eax) and the
+    ; address of the multiboot information structure (ebx)
+    push    ebx
+    push    eax
     call runKernel
 
     ; Infinite loop (should never get here)
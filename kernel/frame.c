@@ -0,0 +1,331 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file frame.c
+/// \brief Implementation of the physical page frame allocator.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "frame.h"
+
+#include "io.h"
+#include "paging.h"
+#include "sync.h"
+#include "x86.h"
+#include "../common/string.h"
+
+#define MAX_REGIONS     32
+#define LOW_MEMORY_END  0x100000
+
+// Content of the frame_info byte of the first frame of a block
+#define BLOCK_FREE      0x80
+#define BLOCK_ALLOCATED 0x40
+#define BLOCK_ORDER     0x1F
+
+#define FRAME_INDEX(address) ((address) / FRAME_SIZE)
+#define BLOCK_SIZE(order)    ((uint32_t)FRAME_SIZE << (order))
+
+// End of the kernel image, defined in kernel.ld
+extern uint8_t _kernel_end[];
+
+// Free blocks are linked through their first bytes
+typedef struct free_block_st {
+    struct free_block_st *next;
+    struct free_block_st *prev;
+} free_block_t;
+
+// Usable memory region [start, end[
+typedef struct region_st {
+    uint32_t start;
+    uint32_t end;
+} region_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static free_block_t *free_lists[FRAME_MAX_ORDER + 1];
+static frame_stats_t stats[FRAME_MAX_ORDER + 1];
+static uint8_t *frame_info = NULL;  // One byte per frame, up to memory_end
+static uint32_t *frame_refs = NULL; // Additional references of each frame (frame_share)
+static uint32_t memory_end = 0;
+static uint32_t nb_frames = 0;      // Number of usable frames
+static uint32_t nb_free_frames = 0;
+static spinlock_t lock;            // Protects all of the above once initialized
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+static inline uint32_t align_up(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void push_block(uint32_t block, uint32_t order)
+{
+    free_block_t *node = (free_block_t*)block;
+    node->prev = NULL;
+    node->next = free_lists[order];
+    if (node->next != NULL)
+    {
+        node->next->prev = node;
+    }
+    free_lists[order] = node;
+
+    frame_info[FRAME_INDEX(block)] = BLOCK_FREE | order;
+    stats[order].nb_free++;
+    nb_free_frames += 1 << order;
+}
+
+static void remove_block(uint32_t block, uint32_t order)
+{
+    free_block_t *node = (free_block_t*)block;
+    if (node->prev != NULL)
+    {
+        node->prev->next = node->next;
+    }
+    else
+    {
+        free_lists[order] = node->next;
+    }
+    if (node->next != NULL)
+    {
+        node->next->prev = node->prev;
+    }
+
+    frame_info[FRAME_INDEX(block)] = 0;
+    stats[order].nb_free--;
+    nb_free_frames -= 1 << order;
+}
+
+// Adds the frames of [start, end[ as the biggest aligned blocks that fit.
+static void add_range(uint32_t start, uint32_t end)
+{
+    start = align_up(start, FRAME_SIZE);
+    end &= ~(FRAME_SIZE - 1);
+
+    while (start < end)
+    {
+        uint32_t order = 0;
+        while (order < FRAME_MAX_ORDER && start % BLOCK_SIZE(order + 1) == 0
+               && end - start >= BLOCK_SIZE(order + 1))
+        {
+            order++;
+        }
+        push_block(start, order);
+        nb_frames += 1 << order;
+        start += BLOCK_SIZE(order);
+    }
+}
+
+// Copies the available regions of the memory map, before frame_info may overwrite it.
+// Returns the number of regions.
+static uint32_t read_memory_map(multiboot_info_t *info, region_t *regions)
+{
+    uint32_t nb_regions = 0;
+
+    if (info != NULL && (info->flags & MULTIBOOT_INFO_MEM_MAP))
+    {
+        uint32_t address = info->mmap_addr;
+        while (address < info->mmap_addr + info->mmap_length && nb_regions < MAX_REGIONS)
+        {
+            multiboot_mmap_entry_t *entry = (multiboot_mmap_entry_t*)address;
+            uint64_t end = entry->addr + entry->len;
+
+            // Only the identity mapped memory can be used by the kernel
+            if (entry->type == MULTIBOOT_MEMORY_AVAILABLE && entry->addr < PAGING_IDENTITY_SIZE)
+            {
+                regions[nb_regions].start = (uint32_t)entry->addr;
+                regions[nb_regions].end = end > PAGING_IDENTITY_SIZE ? PAGING_IDENTITY_SIZE : (uint32_t)end;
+                nb_regions++;
+            }
+            address += entry->size + sizeof(entry->size);
+        }
+    }
+    else if (info != NULL && (info->flags & MULTIBOOT_INFO_MEMORY))
+    {
+        uint64_t end = LOW_MEMORY_END + (uint64_t)info->mem_upper * 1024;
+        regions[0].start = LOW_MEMORY_END;
+        regions[0].end = end > PAGING_IDENTITY_SIZE ? PAGING_IDENTITY_SIZE : (uint32_t)end;
+        nb_regions = 1;
+    }
+    else
+    {
+        regions[0].start = LOW_MEMORY_END;
+        regions[0].end = FRAME_MEMORY_END;
+        nb_regions = 1;
+    }
+    return nb_regions;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void frame_init(multiboot_info_t *info)
+{
+    region_t regions[MAX_REGIONS];
+    uint32_t nb_regions = read_memory_map(info, regions);
+
+    for (uint32_t i = 0; i < nb_regions; i++)
+    {
+        if (regions[i].end > memory_end)
+        {
+            memory_end = regions[i].end;
+        }
+    }
+
+    spinlock_init(&lock, "frame");
+
+    // The frame descriptors and reference counts are stored right after the kernel image
+    frame_info = (uint8_t*)align_up((uint32_t)_kernel_end, FRAME_SIZE);
+    frame_refs = (uint32_t*)align_up((uint32_t)frame_info + FRAME_INDEX(memory_end), sizeof(uint32_t));
+    memset(frame_info, 0, FRAME_INDEX(memory_end));
+    memset(frame_refs, 0, FRAME_INDEX(memory_end) * sizeof(uint32_t));
+    uint32_t first_free = align_up((uint32_t)(frame_refs + FRAME_INDEX(memory_end)), FRAME_SIZE);
+
+    for (uint32_t i = 0; i < nb_regions; i++)
+    {
+        uint32_t start = regions[i].start;
+        if (start < first_free)
+        {
+            start = first_free;
+        }
+        if (start < regions[i].end)
+        {
+            add_range(start, regions[i].end);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t frame_alloc()
+{
+    return frame_alloc_order(0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t frame_alloc_order(uint32_t order)
+{
+    if (order > FRAME_MAX_ORDER)
+    {
+        return 0;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+
+    // Smallest free block that is big enough
+    uint32_t current = order;
+    while (current <= FRAME_MAX_ORDER && free_lists[current] == NULL)
+    {
+        current++;
+    }
+    if (current > FRAME_MAX_ORDER)
+    {
+        spin_unlock_irqrestore(&lock, flags);
+        return 0;
+    }
+
+    uint32_t block = (uint32_t)free_lists[current];
+    remove_block(block, current);
+
+    // Give the upper halves back until the block has the requested size
+    while (current > order)
+    {
+        stats[current].nb_splits++;
+        current--;
+        push_block(block + BLOCK_SIZE(current), current);
+    }
+
+    frame_info[FRAME_INDEX(block)] = BLOCK_ALLOCATED | order;
+    stats[order].nb_allocs++;
+
+    spin_unlock_irqrestore(&lock, flags);
+    return block;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void frame_free(uint32_t frame)
+{
+    uint32_t flags = spin_lock_irqsave(&lock);
+
+    if (frame >= memory_end || !(frame_info[FRAME_INDEX(frame)] & BLOCK_ALLOCATED))
+    {
+        spin_unlock_irqrestore(&lock, flags);
+        return;
+    }
+
+    // A shared block is only freed by its last owner
+    if (frame_refs[FRAME_INDEX(frame)] > 0)
+    {
+        frame_refs[FRAME_INDEX(frame)]--;
+        spin_unlock_irqrestore(&lock, flags);
+        return;
+    }
+
+    uint32_t order = frame_info[FRAME_INDEX(frame)] & BLOCK_ORDER;
+    frame_info[FRAME_INDEX(frame)] = 0;
+    stats[order].nb_frees++;
+
+    // Merge with the buddy as long as it is entirely free
+    while (order < FRAME_MAX_ORDER)
+    {
+        uint32_t buddy = frame ^ BLOCK_SIZE(order);
+        if (buddy >= memory_end || frame_info[FRAME_INDEX(buddy)] != (BLOCK_FREE | order))
+        {
+            break;
+        }
+        remove_block(buddy, order);
+        stats[order].nb_merges++;
+        frame &= ~BLOCK_SIZE(order);
+        order++;
+    }
+    push_block(frame, order);
+
+    spin_unlock_irqrestore(&lock, flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void frame_share(uint32_t frame)
+{
+    uint32_t flags = spin_lock_irqsave(&lock);
+    if (frame < memory_end && (frame_info[FRAME_INDEX(frame)] & BLOCK_ALLOCATED))
+    {
+        frame_refs[FRAME_INDEX(frame)]++;
+    }
+    spin_unlock_irqrestore(&lock, flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+bool frame_is_shared(uint32_t frame)
+{
+    return frame < memory_end && frame_refs[FRAME_INDEX(frame)] > 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t frame_nb_free()
+{
+    return nb_free_frames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void frame_get_stats(uint32_t order, frame_stats_t *order_stats)
+{
+    if (order <= FRAME_MAX_ORDER)
+    {
+        uint32_t flags = spin_lock_irqsave(&lock);
+        *order_stats = stats[order];
+        spin_unlock_irqrestore(&lock, flags);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void frame_dump_stats()
+{
+    // Copied, so that the lock isn't held while printing
+    frame_stats_t copy[FRAME_MAX_ORDER + 1];
+    uint32_t flags = spin_lock_irqsave(&lock);
+    uint32_t nb_free = nb_free_frames;
+    memcpy(copy, stats, sizeof(stats));
+    spin_unlock_irqrestore(&lock, flags);
+
+    printf("frames: %u usable, %u free (%u KB), memory end %x\n", nb_frames, nb_free,
+           nb_free * (FRAME_SIZE / 1024), memory_end);
+    printf("order\tfree\tallocs\tfrees\tsplits\tmerges\n");
+    for (uint32_t order = 0; order <= FRAME_MAX_ORDER; order++)
+    {
+        printf("%u\t%u\t%u\t%u\t%u\t%u\n", order, copy[order].nb_free, copy[order].nb_allocs,
+               copy[order].nb_frees, copy[order].nb_splits, copy[order].nb_merges);
+    }
+}
@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file frame.h
+/// \brief Declaration of the physical page frame allocator.
+///
+/// The frames are managed by a buddy allocator: a block of order n is made of 2^n
+/// contiguous frames and is aligned on its size. Each order has a doubly linked free
+/// list threaded through the free blocks themselves, and one byte per frame tells
+/// whether it starts a free block and its order. Allocating or freeing a block takes at
+/// most FRAME_MAX_ORDER splits or merges, a single frame is usually served directly
+/// from the order 0 list.
+///
+/// The usable memory is given by the multiboot memory map, limited to the memory
+/// identity mapped for the kernel (see paging.h). The physical address of a frame can
+/// be used directly by the kernel.
+///
+/// The free lists, the counters and the reference counts are protected by a spinlock
+/// taken with the interruptions disabled: any processor and the interruption routines
+/// can allocate and free frames.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+#include "../common/types.h"
+#include "multiboot.h"
+
+#define FRAME_SIZE          4096
+#define FRAME_MAX_ORDER     10          // 4 MB blocks
+#define FRAME_MEMORY_END    0x2000000   // Used when the bootloader gives no memory map
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct frame_stats_t
+/// \brief Statistics of one order of the allocator.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct frame_stats_st {
+    uint32_t nb_free;       ///< Number of free blocks
+    uint32_t nb_allocs;     ///< Number of blocks allocated since the initialization
+    uint32_t nb_frees;      ///< Number of blocks freed since the initialization
+    uint32_t nb_splits;     ///< Number of blocks split to serve a smaller order
+    uint32_t nb_merges;     ///< Number of blocks merged with their buddy
+} frame_stats_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void frame_init(multiboot_info_t *info)
+/// \brief Builds the free lists from the memory map given by the bootloader.
+///
+/// The frames of the kernel image and those below 1 MB are never used.
+///
+/// \param info : Multiboot information or NULL to use the memory up to
+///               FRAME_MEMORY_END.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void frame_init(multiboot_info_t *info);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t frame_alloc()
+/// \brief Allocates a physical frame. Its content is undefined.
+/// \return The physical address of the frame or 0 if there is no free frame.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t frame_alloc();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t frame_alloc_order(uint32_t order)
+/// \brief Allocates 2^order contiguous frames, aligned on their size.
+/// \return The physical address of the first frame or 0 if no block is big enough.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t frame_alloc_order(uint32_t order);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void frame_free(uint32_t frame)
+/// \brief Gives back a block returned by frame_alloc() or frame_alloc_order().
+///
+/// If the block is shared (see frame_share()), only one reference is dropped.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void frame_free(uint32_t frame);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void frame_share(uint32_t frame)
+/// \brief Adds an owner to an allocated block, each owner calls frame_free() once.
+///
+/// Used by the pages shared copy on write between tasks and by the shared memory regions
+/// (see paging.h). The owners are counted on 32 bits, more than the page table entries
+/// which can map a block.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void frame_share(uint32_t frame);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool frame_is_shared(uint32_t frame)
+/// \brief Returns whether an allocated block has more than one owner.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern bool frame_is_shared(uint32_t frame);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t frame_nb_free()
+/// \brief Returns the number of free frames.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t frame_nb_free();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void frame_get_stats(uint32_t order, frame_stats_t *stats)
+/// \brief Copies the statistics of an order (0 to FRAME_MAX_ORDER).
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void frame_get_stats(uint32_t order, frame_stats_t *stats);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void frame_dump_stats()
+/// \brief Prints the usable memory and the statistics of each order.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void frame_dump_stats();
+
+#endif
@@ -5,18 +5,38 @@
 #include "pfs.h"
 
 #include "io.h"
+#include "frame.h"
+#include "image.h"
+#include "kmalloc.h"
+#include "paging.h"
+#include "pipe.h"
+#include "shm.h"
+#include "sync.h"
+#include "trace.h"
 
 #define GDT_INDEX_TO_SELECTOR(idx) ((idx) << 3)
 #define GDT_SELECTOR_TO_INDEX(sel) ((sel) >> 3)
 
+// Segments of the LDT of a task
+#define LDT_CODE_INDEX 0
+#define LDT_DATA_INDEX 1
+
 // GDT
-static gdt_entry_t gdt[3 + 1 + MAX_NB_TASKS * 2];
+static gdt_entry_t gdt[3 + MAX_NB_CPUS + MAX_NB_TASKS * 2];
+
+// Initial TSS of each processor
+static tss_t cpu_tss[MAX_NB_CPUS];
 
 // Pointer on the GDT
 static gdt_ptr_t gdt_ptr;
 
-// Tasks
-static task_t tasks[MAX_NB_TASKS];
+// Tasks, allocated from task_cache when their slot is taken, NULL for the free slots
+static task_t *tasks[MAX_NB_TASKS];
+static kmem_cache_t *task_cache;
+
+// Stack of the free task slots
+static uint16_t free_slots[MAX_NB_TASKS];
+static uint32_t nb_free_slots;
 
 // Build and return a GDT entry given the various arguments (see Intel manuals).
 static gdt_entry_t build_entry(uint32_t base, uint32_t limit, uint8_t type, uint8_t s, uint8_t db, uint8_t granularity, uint8_t dpl) {
@@ -71,70 +91,382 @@ uint gdt_entry_to_selector(gdt_entry_t *entry) {
 	return GDT_INDEX_TO_SELECTOR(entry - gdt);
 }
 
+static void init_task(int i);
+
+// Takes a free task slot and allocates the task structure and kernel stack. Returns the
+// index of the slot or -1 if there is no free slot or not enough memory.
+static int alloc_task()
+{
+	if (nb_free_slots == 0)
+	{
+		return -1;
+	}
+
+	task_t *task = kmem_cache_alloc(task_cache);
+	uint32_t kernel_stack = frame_alloc_order(TASKS_KERNEL_STACK_ORDER);
+	if (task == NULL || kernel_stack == 0)
+	{
+		if (task != NULL)
+		{
+			kmem_cache_free(task_cache, task);
+		}
+		frame_free(kernel_stack);
+		return -1;
+	}
+
+	int i = free_slots[--nb_free_slots];
+	tasks[i] = task;
+	memset(task, 0, sizeof(task_t));
+	task->kernel_stack = kernel_stack;
+	init_task(i);
+	return i;
+}
+
+// Frees the task of slot i and its descriptors, the slot can be taken again.
+static void free_task(int i)
+{
+	frame_free(tasks[i]->kernel_stack);
+	kmem_cache_free(task_cache, tasks[i]);
+	tasks[i] = NULL;
+
+	gdt[TASKS_FIRST_GDT_ENTRY + i * 2] = null_segment();
+	gdt[TASKS_FIRST_GDT_ENTRY + i * 2 + 1] = null_segment();
+	free_slots[nb_free_slots++] = i;
+}
+
+// Sizes the memory window of the task of slot i: its code and data segments end with it.
+static void set_task_memory(int i, uint32_t memory_size, uint32_t stack_size)
+{
+	tasks[i]->memory_size = memory_size;
+	tasks[i]->stack_size = stack_size;
+
+	// Define code and data segments in the LDT; both segments are overlapping
+	// Every task sees its memory at the same linear address, in its own page directory
+	tasks[i]->ldt[LDT_CODE_INDEX] = gdt_make_code_segment(PAGING_USER_BASE, memory_size / PAGE_SIZE - 1, DPL_USER);  // code
+	tasks[i]->ldt[LDT_DATA_INDEX] = gdt_make_data_segment(PAGING_USER_BASE, memory_size / PAGE_SIZE - 1, DPL_USER);  // data + stack
+}
+
+// Gives a task its parent and adds it to the children of the parent, if any.
+static void set_parent(task_t *task, task_t *parent)
+{
+	task->parent = parent;
+	if (parent != NULL)
+	{
+		task->sibling = parent->children;
+		parent->children = task;
+	}
+}
+
+// Removes a task from the children of its parent.
+static void remove_child(task_t *task)
+{
+	task_t *previous = NULL;
+	task_t *child = task->parent->children;
+	while (child != task)
+	{
+		previous = child;
+		child = child->sibling;
+	}
+
+	if (previous != NULL)
+	{
+		previous->sibling = task->sibling;
+	}
+	else
+	{
+		task->parent->children = task->sibling;
+	}
+	task->sibling = NULL;
+}
+
+// Destroys the task of slot i, which exited or is blocked, and the blocked tasks it
+// executed or forked: nobody is left to wait for them. The others lose their parent.
+static void destroy_task(int i)
+{
+	task_t *task = tasks[i];
+	while (task->children != NULL)
+	{
+		task_t *child = task->children;
+		task->children = child->sibling;
+		child->sibling = NULL;
+		child->parent = NULL;
+		if (child->blocked)
+		{
+			destroy_task(task_index(child));
+		}
+	}
+
+	// Its parent may wait for it in exec_task()
+	if (task->parent != NULL)
+	{
+		if (task->parent->exec_child == task)
+		{
+			task->parent->exec_child = NULL;
+		}
+		remove_child(task);
+	}
+
+	ipc_task_exit(task);
+	pipe_task_exit(task);
+	wait_queue_task_exit(task);
+	shm_task_exit(task);
+	paging_destroy_directory(task->tss.cr3);
+	image_put(task->image);
+	free_task(i);
+}
+
 void setup_task(int i)
 {
-	tasks[i].free = 0;
+	// The memory declared in the header of the program, the heap starts after its bss
+	image_t *image = tasks[i]->image;
+	if (image->memory_size != 0)
+	{
+		set_task_memory(i, image->memory_size, image->stack_size);
+	}
+	else
+	{
+		set_task_memory(i, TASKS_MEMORY_SIZE, TASKS_STACK_SIZE);
+	}
+	tasks[i]->heap_start = tasks[i]->brk = image->bss_end;
+
 	// Setup code and stack pointers
-	tasks[i].tss.eip = 0;
-	tasks[i].tss.esp = tasks[i].tss.ebp = TASKS_MEMORY_SIZE;  // stack pointers
+	tasks[i]->tss.eip = 0;
+	tasks[i]->tss.esp = tasks[i]->tss.ebp = tasks[i]->memory_size;  // stack pointers
+}
+
+// Returns whether a blocked task can be called at any time: it checks again what it
+// waits for. Waiting on a port, it expects a message or a reply.
+static bool is_callable(task_t *task)
+{
+	return task->blocked && (task->pipe_wait != NULL || task->wait_queue != NULL || task->in_exec);
+}
+
+// Returns whether a task can block: the kernel itself can't be left waiting, nor the
+// task it called.
+static bool can_block(task_t *task)
+{
+	return GDT_SELECTOR_TO_INDEX(task->tss.previous_task_link) >= TASKS_FIRST_GDT_ENTRY;
+}
+
+// Returns the last task of the chain of programs executed from a program.
+static task_t* last_exec(task_t *program)
+{
+	while (program->exec_child != NULL)
+	{
+		program = program->exec_child;
+	}
+	return program;
+}
+
+// Calls a task executed by the current one until it exits. When it blocks, waiting on a
+// pipe for example, the current task blocks too and calls it again when it is called
+// itself, unless the program exited meanwhile. The first task can't block: it is the
+// idle point while the program sleeps on a wait queue, and leaves the program blocked
+// otherwise, like a forked task.
+static void run_program(task_t *program)
+{
+	task_t *task = current_task();
+	if (task == NULL)
+	{
+		task_resume(program);
+		return;
+	}
+
+	task->exec_child = program;
+	bool blocked = task_resume(program);
+	task->in_exec = true;
+	while (blocked && task->exec_child != NULL)
+	{
+		if (task_block())
+		{
+			// Not callable when it is the one which called the task
+			if (task->exec_child != NULL && is_callable(program))
+			{
+				blocked = task_resume(program);
+			}
+			continue;
+		}
+
+		task_t *last = last_exec(program);
+		if (last->wait_queue != NULL)
+		{
+			// The idle processor resumes the last task once it is woken
+			uint32_t flags = irq_save();
+			wait_queue_idle();
+			irq_restore(flags);
+		}
+		else if (last->in_exec)
+		{
+			// Its program exited: the chain is called again down to it
+			blocked = task_resume(program);
+		}
+		else
+		{
+			break;
+		}
+	}
+	task->in_exec = false;
+	task->exec_child = NULL;
 }
 
 int exec_task(char *fileName)
 {
-	// Searching a free task slot
-	int i = 0;
-	for (; i < MAX_NB_TASKS && !tasks[i].free; i++);
+	int i = alloc_task();
+	if (i == -1)
+	{
+		return -1;
+	}
+
+	TRACE_EVENT(TRACE_EXEC_BEGIN, i);
 
-	if (i == MAX_NB_TASKS)
+	// The file name may be in the caller's memory, which isn't mapped in the new task
+	strncpy(tasks[i]->name, fileName, sizeof(tasks[i]->name) - 1);
+
+	uint32_t directory = paging_create_directory();
+	if (directory == 0)
 	{
+		free_task(i);
+		TRACE_EVENT(TRACE_EXEC_END, i);
 		return -1;
 	}
 
-	// Copying the user program into the task memory
-	if (file_read(fileName, (uint32_t*)tasks[i].memory) == -1)
+	// The user program isn't copied: the page fault handler maps the pages of its image
+	// when the task first touches them, reading them from the file if they aren't cached
+	stat_t st;
+	file_iterator_t file = find_file(tasks[i]->name);
+	if (!file.boundToFile || file_stat(tasks[i]->name, &st) == -1)
 	{
+		paging_destroy_directory(directory);
+		free_task(i);
+		TRACE_EVENT(TRACE_EXEC_END, i);
 		return -2;
 	}
+	tasks[i]->image = image_get(&file, st.size);
+	if (tasks[i]->image == NULL || tasks[i]->image->memory_size > TASKS_MAX_MEMORY_SIZE)
+	{
+		if (tasks[i]->image != NULL)
+		{
+			image_put(tasks[i]->image);
+		}
+		paging_destroy_directory(directory);
+		free_task(i);
+		TRACE_EVENT(TRACE_EXEC_END, i);
+		return -1;
+	}
 
-	// Starting the task
+	// Starting the task, the CPU loads its page directory from the TSS
+	tasks[i]->tss.cr3 = directory;
+	set_parent(tasks[i], current_task());
+	pipe_task_inherit(tasks[i], tasks[i]->parent);
 	setup_task(i);
-	extern void call_task(uint16_t tss_selector);
-	call_task((uint16_t)tasks[i].tss_selector);
-
-	// Task is now over
-	tasks[i].free = 1;
+	run_program(tasks[i]);
+	TRACE_EVENT(TRACE_EXEC_END, i);
 	return 0;
 }
 
-void init_task(int i)
+int fork_task()
 {
-	gdt[TASKS_FIRST_GDT_ENTRY + i * 2] = gdt_make_tss(&tasks[i].tss, DPL_KERNEL);
-	gdt[TASKS_FIRST_GDT_ENTRY + i * 2 + 1] = gdt_make_ldt((uint32_t)tasks[i].ldt, sizeof(tasks[i].ldt)-1, DPL_KERNEL);
+	task_t *parent = current_task();
+	if (parent == NULL)
+	{
+		return -1;
+	}
 
-	tasks[i].tss_selector = gdt_entry_to_selector(&gdt[TASKS_FIRST_GDT_ENTRY + i * 2]);
-	tasks[i].ldt_selector = gdt_entry_to_selector(&gdt[TASKS_FIRST_GDT_ENTRY + i * 2 + 1]);
+	int i = alloc_task();
+	if (i == -1)
+	{
+		return -1;
+	}
 
-	tasks[i].free = 1;
+	TRACE_EVENT(TRACE_FORK_BEGIN, i);
 
-	// Define code and data segments in the LDT; both segments are overlapping
-	int ldt_code_idx = 0;
-	int ldt_data_idx = 1;
+	// The memory of the parent is shared copy on write, nothing is read from the disk
+	uint32_t directory = paging_fork_directory();
+	if (directory == 0)
+	{
+		free_task(i);
+		TRACE_EVENT(TRACE_FORK_END, i);
+		return -1;
+	}
+
+	strncpy(tasks[i]->name, parent->name, sizeof(tasks[i]->name) - 1);
+	tasks[i]->image = parent->image;
+	image_share(tasks[i]->image);
+	set_task_memory(i, parent->memory_size, parent->stack_size);
+	tasks[i]->heap_start = parent->heap_start;
+	tasks[i]->brk = parent->brk;
+
+	// The child resumes where the parent made the system call, fork() returning 0
+	syscall_frame_t *frame = task_syscall_frame(parent);
+	tasks[i]->tss.cr3 = directory;
+	tasks[i]->tss.eip = frame->eip;
+	tasks[i]->tss.eflags = frame->eflags;
+	tasks[i]->tss.esp = frame->esp;
+	tasks[i]->tss.ebp = frame->ebp;
+	tasks[i]->tss.eax = 0;
+	tasks[i]->tss.ebx = frame->ebx;
+	tasks[i]->tss.ecx = frame->ecx;
+	tasks[i]->tss.edx = frame->edx;
+	tasks[i]->tss.esi = frame->esi;
+	tasks[i]->tss.edi = frame->edi;
+
+	// Tasks aren't preempted: the child runs until it exits or blocks, then the parent
+	// resumes
+	set_parent(tasks[i], parent);
+	pipe_task_inherit(tasks[i], parent);
+	task_resume(tasks[i]);
+	TRACE_EVENT(TRACE_FORK_END, i);
+	return i + 1;
+}
+
+int wait_task(int pid)
+{
+	task_t *task = current_task();
+	task_t *child = pid >= 1 && pid <= MAX_NB_TASKS ? tasks[pid - 1] : NULL;
+	if (task == NULL || child == NULL || child->parent != task)
+	{
+		return 0;
+	}
 
-	tasks[i].ldt[ldt_code_idx] = gdt_make_code_segment((uint32_t)tasks[i].memory, TASKS_MEMORY_SIZE / 4096, DPL_USER);  // code
-	tasks[i].ldt[ldt_data_idx] = gdt_make_data_segment((uint32_t)tasks[i].memory, TASKS_MEMORY_SIZE / 4096, DPL_USER);  // data + stack
+	if (!is_callable(child))
+	{
+		return -1;
+	}
+
+	// Sleeping on a wait queue, it is resumed by the idle processor once woken
+	if (child->wait_queue != NULL && !can_block(task))
+	{
+		uint32_t flags = irq_save();
+		wait_queue_idle();
+		irq_restore(flags);
+		return tasks[pid - 1] == child && child->parent == task ? 1 : 0;
+	}
+	return task_resume(child) ? 1 : 0;
+}
+
+// Initializes the descriptors of the task of slot i, whose structure and kernel stack
+// are allocated.
+static void init_task(int i)
+{
+	gdt[TASKS_FIRST_GDT_ENTRY + i * 2] = gdt_make_tss(&tasks[i]->tss, DPL_KERNEL);
+	gdt[TASKS_FIRST_GDT_ENTRY + i * 2 + 1] = gdt_make_ldt((uint32_t)tasks[i]->ldt, sizeof(tasks[i]->ldt)-1, DPL_KERNEL);
 
+	tasks[i]->tss_selector = gdt_entry_to_selector(&gdt[TASKS_FIRST_GDT_ENTRY + i * 2]);
+	tasks[i]->ldt_selector = gdt_entry_to_selector(&gdt[TASKS_FIRST_GDT_ENTRY + i * 2 + 1]);
+
+	// The code and data segments are set by set_task_memory()
 	// Initialize the TSS fields
 	// The LDT selector must point to the task's LDT
-	tasks[i].tss.ldt_selector = tasks[i].ldt_selector;
+	tasks[i]->tss.ldt_selector = tasks[i]->ldt_selector;
 
 	// Code and data segment selectors are in the LDT
-	tasks[i].tss.cs = GDT_INDEX_TO_SELECTOR(ldt_code_idx) | DPL_USER | LDT_SELECTOR;
-	tasks[i].tss.ds = tasks[i].tss.es = tasks[i].tss.fs = tasks[i].tss.gs = tasks[i].tss.ss = GDT_INDEX_TO_SELECTOR(ldt_data_idx) | DPL_USER | LDT_SELECTOR;
-	tasks[i].tss.eflags = 512;  // Activate hardware interrupts (bit 9)
+	tasks[i]->tss.cs = GDT_INDEX_TO_SELECTOR(LDT_CODE_INDEX) | DPL_USER | LDT_SELECTOR;
+	tasks[i]->tss.ds = tasks[i]->tss.es = tasks[i]->tss.fs = tasks[i]->tss.gs = tasks[i]->tss.ss = GDT_INDEX_TO_SELECTOR(LDT_DATA_INDEX) | DPL_USER | LDT_SELECTOR;
+	tasks[i]->tss.eflags = 512;  // Activate hardware interrupts (bit 9)
 
 	// Task's kernel stack
-	tasks[i].tss.ss0 = GDT_KERNEL_DATA_SELECTOR;
-	tasks[i].tss.esp0 = (uint32_t)(tasks[i].kernel_stack) + sizeof(tasks[i].kernel_stack);
+	tasks[i]->tss.ss0 = GDT_KERNEL_DATA_SELECTOR;
+	tasks[i]->tss.esp0 = tasks[i]->kernel_stack + TASKS_KERNEL_STACK_SIZE;
 }
 
 // Initialize the GDT
@@ -149,30 +481,100 @@ void gdt_init()
 	gdt[1] = gdt_make_code_segment(0, 1048575, DPL_KERNEL);
 	gdt[2] = gdt_make_data_segment(0, 1048575, DPL_KERNEL);
 
-    // Load the GDT
-    gdt_flush(&gdt_ptr);
-
-	// gdt[3] : entry for initial kernel TSS (CPU state of first task saved there)
+	// gdt[3] : entry for the initial kernel TSS of the bootstrap processor, the other
+	// processors load theirs when they start (see smp.c)
 	static uint8_t initial_tss_kernel_stack[65536]; // 64KB of stack
-	static tss_t initial_tss;
-	gdt[3] = gdt_make_tss(&initial_tss, DPL_KERNEL);
-	memset(&initial_tss, 0, sizeof(tss_t));
-	initial_tss.ss0 = GDT_KERNEL_DATA_SELECTOR;
-	initial_tss.esp0 = ((uint32_t)initial_tss_kernel_stack) + sizeof(initial_tss_kernel_stack);
+	gdt_init_cpu(0, (uint32_t)initial_tss_kernel_stack + sizeof(initial_tss_kernel_stack));
+
+	// The tasks are created on demand, the first slots are taken first
+	task_cache = kmem_cache_create("task", sizeof(task_t));
+	for (int i = MAX_NB_TASKS - 1; i >= 0; i--)
+	{
+		free_slots[nb_free_slots++] = i;
+	}
+}
+
+// Loads the GDT and the initial TSS of a processor, kernel_stack is the top of its stack.
+void gdt_init_cpu(int cpu, uint32_t kernel_stack)
+{
+	gdt_flush(&gdt_ptr);
+
+	// gdt[3 + cpu] : CPU state of the kernel saved there when the processor calls a task
+	tss_t *tss = &cpu_tss[cpu];
+	gdt[3 + cpu] = gdt_make_tss(tss, DPL_KERNEL);
+	memset(tss, 0, sizeof(tss_t));
+	tss->ss0 = GDT_KERNEL_DATA_SELECTOR;
+	tss->esp0 = kernel_stack;
+	// The CR3 field isn't saved on task switches, the kernel directory is loaded back
+	// when the first task returns
+	tss->cr3 = paging_kernel_directory();
 
 	// Load the task register to point to the initial TSS selector.
 	// IMPORTANT: The GDT must be already loaded before loading the task register!
 	extern void load_task_register(uint16_t tss_selector);  // Implemented in task_asm.s
-	load_task_register(gdt_entry_to_selector(&gdt[3]));
+	load_task_register(gdt_entry_to_selector(&gdt[3 + cpu]));
+}
 
-	// Init the tasks structures and descriptors
-	for (int i = 0; i < MAX_NB_TASKS; i++)
+task_t* get_task(uint32_t tss_selector)
+{
+	return tasks[(GDT_SELECTOR_TO_INDEX(tss_selector) - TASKS_FIRST_GDT_ENTRY) / 2];
+}
+
+// Return the task currently executing on the CPU, or NULL if the kernel runs on the
+// initial TSS.
+task_t* current_task()
+{
+	uint16_t tss_selector = get_task_register();
+	if (GDT_SELECTOR_TO_INDEX(tss_selector) < TASKS_FIRST_GDT_ENTRY)
 	{
-		init_task(i);
+		return NULL;
 	}
+	return get_task(tss_selector);
 }
 
-task_t* get_task(uint32_t tss_selector)
+int task_index(task_t *task)
+{
+	return (GDT_SELECTOR_TO_INDEX(task->tss_selector) - TASKS_FIRST_GDT_ENTRY) / 2;
+}
+
+task_t* task_at(int i)
 {
-	return &tasks[(GDT_SELECTOR_TO_INDEX(tss_selector) - TASKS_FIRST_GDT_ENTRY) / 2];
+	return tasks[i];
+}
+
+syscall_frame_t* task_syscall_frame(task_t *task)
+{
+	return (syscall_frame_t*)(task->tss.esp0 - sizeof(syscall_frame_t));
+}
+
+bool task_block()
+{
+	task_t *task = current_task();
+	if (task == NULL || !can_block(task))
+	{
+		return false;
+	}
+
+	task->blocked = true;
+	extern void return_task();  // Implemented in task_asm.s
+	return_task();
+	return true;
+}
+
+bool task_resume(task_t *task)
+{
+	int i = task_index(task);
+	task->blocked = false;
+
+	extern void call_task(uint16_t tss_selector);
+	TRACE_EVENT(TRACE_TASK_SWITCH, i);
+	call_task((uint16_t)task->tss_selector);
+	TRACE_EVENT(TRACE_TASK_RETURN, i);
+
+	if (task->blocked)
+	{
+		return true;
+	}
+	destroy_task(i);
+	return false;
 }
@@ -3,11 +3,17 @@
 
 #include "../common/types.h"
 #include "task.h"
+#include "image.h"
+#include "ipc.h"
+#include "smp.h"
 
-#define MAX_NB_TASKS 8
-#define TASKS_FIRST_GDT_ENTRY   4
-#define TASKS_MEMORY_SIZE       0x100000
+#define MAX_NB_TASKS 1024	// Task slots, each one takes 2 GDT descriptors (TSS and LDT)
+#define TASKS_FIRST_GDT_ENTRY   (3 + MAX_NB_CPUS)	// After the TSS of each processor
+#define TASKS_MEMORY_SIZE       0x100000	// Memory of the programs without header (see image.h)
+#define TASKS_MAX_MEMORY_SIZE   0x10000000	// Largest memory declared by a program
+#define TASKS_KERNEL_STACK_ORDER 4	// Kernel stacks are blocks of 2^4 frames
 #define TASKS_KERNEL_STACK_SIZE 0x10000
+#define TASKS_STACK_SIZE        0x10000	// Stack of the programs without header
 
 // Structure of a GDT descriptor. There are 2 types of descriptors: segments and TSS.
 // Section 3.4.5 of Intel 64 & IA32 architectures software developer's manual describes
@@ -35,13 +41,42 @@ typedef struct __attribute__((packed)) gdt_entry_st {
 typedef struct __attribute__((packed)) task_st {
     tss_t 		tss;
     gdt_entry_t ldt[2];
-    uint8_t     memory[TASKS_MEMORY_SIZE];
-    uint8_t 	kernel_stack[TASKS_KERNEL_STACK_SIZE];
+    uint32_t	kernel_stack;	// Lowest address of the kernel stack
     uint32_t	tss_selector;
     uint32_t	ldt_selector;
-    uint8_t		free;
+    image_t		*image;		// Cached pages of the executed file (see paging.c)
+    uint32_t	memory_size;	// Size of the memory window, limit of the LDT segments
+    uint32_t	stack_size;	// Top of the memory kept for the user stack
+    uint32_t	heap_start;	// First program break set by the task, 0 if not set yet
+    uint32_t	brk;		// Current program break (end of the heap)
+    char		name[32];	// Name of the executed file
+    struct task_st *parent;	// Task which executed or forked it, NULL for the first one
+    struct task_st *children;	// Tasks it executed or forked, linked through sibling
+    struct task_st *sibling;	// Next child of the same parent
+    bool		blocked;	// Waiting to be called again (see task_block())
+    ipc_msg_t	ipc_msg;	// Message sent, received or replied (see ipc.c)
+    uint32_t	ipc_lent;	// Pages lent by the last message sent
+    bool		ipc_replied;	// The reply to the last message sent is in ipc_msg
+    struct task_st *ipc_client;	// Task waiting for the reply to the message received
+    struct task_st *ipc_next;	// Next task waiting to send on the same port
+    struct pipe_st *pipe_in;	// Input and output, NULL for the keyboard and the screen
+    struct pipe_st *pipe_out;
+    struct pipe_st *pipe_wait;	// Pipe the task waits to read from or write to (see pipe.c)
+    struct task_st *pipe_next;	// Next task waiting on the same pipe
+    struct wait_queue_st *wait_queue;	// Wait queue or woken list the task is in (see sync.h)
+    struct task_st *wait_next;	// Next task of the same list
+    bool		in_exec;	// Waiting in exec_task() for the task it executed
+    struct task_st *exec_child;	// That task, NULL once it exited
 } task_t;
 
+// User context saved on the kernel stack of a task when it makes a system call, by the
+// CPU and by _syscall_handler (syscall_asm.s). From the lowest address.
+typedef struct __attribute__((packed)) syscall_frame_st {
+	uint32_t gs, fs, es, ds;
+	uint32_t ebp, edi, esi, edx, ecx, ebx;
+	uint32_t eip, cs, eflags, esp, ss;
+} syscall_frame_t;
+
 // Structure describing a pointer to the GDT descriptor table.
 // This format is required by the lgdt instruction.
 typedef struct gdt_ptr_st {
@@ -50,8 +85,33 @@ typedef struct gdt_ptr_st {
 } __attribute__((packed)) gdt_ptr_t;
 
 extern void gdt_init();
+extern void gdt_init_cpu(int cpu, uint32_t kernel_stack);
 extern void gdt_flush(gdt_ptr_t *gdt_ptr);
 extern task_t* get_task(uint32_t tss_selector);
 extern int exec_task(char *fileName);
+extern int fork_task();
+
+// Calls a child of the current task (fork_task() returns i + 1 for slot i) which is
+// blocked on a pipe, on a wait queue or in exec_task(). Returns 1 if it blocked again, 0 if it exited or
+// isn't a child, -1 if it is running or waiting on a port.
+extern int wait_task(int pid);
+extern task_t* current_task();
+extern int task_index(task_t *task);
+
+// Returns the task of slot i, NULL if the slot is free.
+extern task_t* task_at(int i);
+
+// Returns the user context saved by the system call the task is in. The registers
+// changed there are returned to the task.
+extern syscall_frame_t* task_syscall_frame(task_t *task);
+
+// Suspends the current task, which is in a system call, and returns to the task which
+// called it. Returns true when the task is called again by task_resume(), false at once
+// if the task was called by the kernel.
+extern bool task_block();
+
+// Calls a blocked task. Returns when the task blocks again, true, or when it exits,
+// false: it is destroyed, with the blocked tasks it executed or forked.
+extern bool task_resume(task_t *task);
 
 #endif
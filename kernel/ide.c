@@ -7,6 +7,7 @@
 
 #include "ide.h"
 #include "periph.h"
+#include "trace.h"
 
 /**
  * Wait for the disk drive to be ready.
@@ -35,6 +36,7 @@ static void pio_prepare(int sector) {
  * Based on the assembly code at http://wiki.osdev.org/ATA_read/write_sectors
  */
 void read_sector(int sector, void *dst) {
+    TRACE_EVENT(TRACE_READ_SECTOR_BEGIN, sector);
     pio_prepare(sector);
 
     outb(0x1f7, 0x20);  // command port: read with retry
@@ -45,6 +47,7 @@ void read_sector(int sector, void *dst) {
         *data = inw(0x1f0);
         data++;
     }
+    TRACE_EVENT(TRACE_READ_SECTOR_END, sector);
 }
 
 /**
@@ -53,6 +56,7 @@ void read_sector(int sector, void *dst) {
  * @param src address of the data to be written
  */
 void write_sector(int sector, void *src) {
+    TRACE_EVENT(TRACE_WRITE_SECTOR_BEGIN, sector);
     pio_prepare(sector);
 
     outb(0x1f7, 0x30);  // command port: write with retry
@@ -63,4 +67,5 @@ void write_sector(int sector, void *src) {
         outw(0x1f0, *data);
         data++;
     }
+    TRACE_EVENT(TRACE_WRITE_SECTOR_END, sector);
 }
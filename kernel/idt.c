@@ -9,12 +9,11 @@
 #include "idt.h"
 
 #include "x86.h"
-#include "pic.h"
+#include "apic.h"
 #include "io.h"
 #include "periph.h"
 #include "string.h"
-#include "keyboard.h"
-#include "timer.h"
+#include "paging.h"
 
 // IDT
 static idt_entry_t idt[IDT_SIZE];
@@ -22,15 +21,6 @@ static idt_entry_t idt[IDT_SIZE];
 // IDT Pointer
 static idt_ptr_t idt_ptr;
 
-// CPU context used when saving/restoring context from an interrupt
-typedef struct regs_st {
-    uint32_t gs, fs, es, ds;
-    uint32_t ebp, edi, esi;
-    uint32_t edx, ecx, ebx, eax;
-    uint32_t number, error_code;
-    uint32_t eip, cs, eflags, esp, ss;
-} regs_t;
-
 // Build and return an IDT entry.
 // selector is the code segment selector in which resides the ISR (Interrupt Service Routine)
 // offset is the address of the ISR (NOTE: for task gates, offset must be 0)
@@ -52,6 +42,25 @@ static idt_entry_t idt_build_entry(uint16_t selector, uint32_t offset, uint8_t t
 //////////////////////////////////////////////////////////////////////////////////////////
 void exception_handler(regs_t *regs)
 {
+    // Pages of the tasks are committed on their first access, with the interruptions
+    // disabled by the gate while the page is copied or read from the disk
+    if (regs->number == 14)
+    {
+        if (regs->eflags & EFLAGS_IF)
+        {
+            LATENCY_IRQS_OFF();
+        }
+        bool handled = paging_handle_fault(regs);
+        if (regs->eflags & EFLAGS_IF)
+        {
+            LATENCY_IRQS_ON();
+        }
+        if (handled)
+        {
+            return;
+        }
+    }
+
     set_colors(RED, BLACK);
 
     switch (regs->number)
@@ -99,7 +108,7 @@ void exception_handler(regs_t *regs)
         printf("Exception %d : General Protection\r\n", regs->number);
         break;
     case 14:
-        printf("Exception %d : Page Fault\r\n", regs->number);
+        printf("Exception %d : Page Fault at %x (error %x)\r\n", regs->number, read_cr2(), regs->error_code);
         break;
     case 15:
         printf("Exception %d : (Intel reserved)\r\n", regs->number);
@@ -125,51 +134,6 @@ void exception_handler(regs_t *regs)
     halt();
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////
-void irq_handler(regs_t *regs)
-{
-    switch (regs->number)
-    {
-    case 0:
-        timer_handler();
-        break;
-    case 1:
-        keyboard_handler();
-        break;
-    case 2:
-        break;
-    case 3:
-        break;
-    case 4:
-        break;
-    case 5:
-        break;
-    case 6:
-        break;
-    case 7:
-        break;
-    case 8:
-        break;
-    case 9:
-        break;
-    case 10:
-        break;
-    case 11:
-        break;
-    case 12:
-        break;
-    case 13:
-        break;
-    case 14:
-        break;
-    case 15:
-        break;
-    default:
-        break;
-    }
-    pic_eoi(regs->number);
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////
 void idt_init()
 {
@@ -224,6 +188,17 @@ void idt_init()
     extern void _syscall_handler();  // Implemented in syscall_asm.s
 	idt[48] = idt_build_entry(GDT_KERNEL_CODE_SELECTOR, (uint32_t)&_syscall_handler, TYPE_TRAP_GATE, DPL_USER);
 
+    idt[APIC_TIMER_VECTOR] = idt_build_entry(GDT_KERNEL_CODE_SELECTOR, (uint32_t)&_irq_16, TYPE_INTERRUPT_GATE, DPL_KERNEL);
+
+    extern void _spurious_interrupt();  // Implemented in idt_asm.s
+    idt[IDT_SPURIOUS_VECTOR] = idt_build_entry(GDT_KERNEL_CODE_SELECTOR, (uint32_t)&_spurious_interrupt, TYPE_INTERRUPT_GATE, DPL_KERNEL);
+
     // Loads the IDT
     idt_load(&idt_ptr);
 }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void idt_init_cpu()
+{
+    idt_load(&idt_ptr);
+}
@@ -12,6 +12,7 @@
 #include "../common/types.h"
 
 #define IDT_SIZE 256
+#define IDT_SPURIOUS_VECTOR 255    // Spurious interrupts of the local APIC
 
 // Structure of an IDT descriptor. There are 3 types of descriptors:
 // a task-gate, an interrupt-gate, and a trap-gate.
@@ -36,9 +37,22 @@ typedef struct idt_ptr_st {
     uint32_t base;    // Address of the first entry
 } __attribute__((packed)) idt_ptr_t;
 
+// CPU context used when saving/restoring context from an interrupt.
+// esp and ss are only valid if the interrupted code was running in user mode.
+typedef struct regs_st {
+    uint32_t gs, fs, es, ds;
+    uint32_t ebp, edi, esi;
+    uint32_t edx, ecx, ebx, eax;
+    uint32_t number, error_code;
+    uint32_t eip, cs, eflags, esp, ss;
+} regs_t;
+
 // IDT Initialization
 extern void idt_init();
 
+// Loads the IDT built by idt_init() on another processor (see smp.c)
+extern void idt_init_cpu();
+
 // IDT Loading
 extern void idt_load(idt_ptr_t *idt_ptr);
 
@@ -82,6 +96,7 @@ extern void _irq_12();
 extern void _irq_13();
 extern void _irq_14();
 extern void _irq_15();
+extern void _irq_16();     // Local APIC timer (see apic.h)
 
 #endif
 
@@ -33,8 +33,9 @@ _irq_%1:
     jmp     irq_wrapper
 %endmacro
 
+; IRQ 16 is the local APIC timer (see apic.h)
 %assign i 0
-%rep 16
+%rep 17
 irq i
 %assign i i+1
 %endrep
@@ -99,3 +100,9 @@ idt_load:
     mov     eax, [esp+4]
     lidt    [eax]
     ret
+
+;------------------------------------------------
+; Spurious interrupt of the local APIC (see smp.c), it must not be acknowledged
+global _spurious_interrupt
+_spurious_interrupt:
+    iret
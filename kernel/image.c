@@ -0,0 +1,230 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file image.c
+/// \brief Implementation of the executable image cache.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "image.h"
+
+#include "frame.h"
+#include "io.h"
+#include "kmalloc.h"
+#include "paging.h"
+#include "../common/string.h"
+
+#define IMAGE_CACHE_PAGES   (IMAGE_CACHE_KB * 1024 / PAGE_SIZE)
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static image_t *images;
+static uint32_t nb_cached_pages;
+static uint32_t use_counter;
+
+static uint32_t nb_exec_hits;       // Launches of a cached image
+static uint32_t nb_exec_misses;
+static uint32_t nb_page_hits;       // Pages mapped without reading the file
+static uint32_t nb_page_misses;
+static uint32_t nb_evictions;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Removes an unused image from the list and frees its pages.
+static void destroy(image_t *image)
+{
+    for (image_t **link = &images; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == image)
+        {
+            *link = image->next;
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < image->nb_pages; i++)
+    {
+        if (image->frames[i] != 0)
+        {
+            frame_free(image->frames[i]);
+        }
+    }
+    nb_cached_pages -= image->nb_loaded;
+    kfree(image->frames);
+    kfree(image);
+}
+
+// Evicts the least recently used unused image. Returns false if every image is in use.
+static bool evict_one()
+{
+    image_t *victim = NULL;
+    for (image_t *image = images; image != NULL; image = image->next)
+    {
+        if (image->users == 0 && (victim == NULL || image->last_use < victim->last_use))
+        {
+            victim = image;
+        }
+    }
+
+    if (victim == NULL)
+    {
+        return false;
+    }
+    destroy(victim);
+    nb_evictions++;
+    return true;
+}
+
+// Evicts unused images until the cached pages fit in the budget.
+static void enforce_budget()
+{
+    while (nb_cached_pages > IMAGE_CACHE_PAGES && evict_one());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+image_t* image_get(file_iterator_t *file, uint32_t size)
+{
+    use_counter++;
+
+    for (image_t *image = images; image != NULL; image = image->next)
+    {
+        if (!image->stale && image->file.index == file->index && image->size == size)
+        {
+            image->users++;
+            image->last_use = use_counter;
+            nb_exec_hits++;
+            return image;
+        }
+    }
+
+    image_t *image = kmalloc(sizeof(image_t));
+    uint32_t nb_pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t *frames = kmalloc((nb_pages + 1) * sizeof(uint32_t));  // Not empty for empty files
+    if (image == NULL || frames == NULL)
+    {
+        kfree(image);
+        kfree(frames);
+        return NULL;
+    }
+
+    memset(frames, 0, nb_pages * sizeof(uint32_t));
+    image->file = *file;
+    image->size = size;
+    image->text_size = 0;
+    image->bss_end = image->stack_size = image->memory_size = 0;
+    image->nb_pages = nb_pages;
+    image->frames = frames;
+    image->nb_loaded = 0;
+    image->users = 1;
+    image->last_use = use_counter;
+    image->stale = false;
+    image->next = images;
+    images = image;
+    nb_exec_misses++;
+
+    // Size of the pages shared read-only and of the task memory, the header is in the first
+    // page. A header whose sizes don't fit together is ignored.
+    uint32_t first_page = image_page(image, 0);
+    image_header_t *header = (image_header_t*)(first_page + IMAGE_HEADER_OFFSET);
+    if (first_page != 0 && size >= IMAGE_HEADER_OFFSET + sizeof(image_header_t)
+        && header->magic == IMAGE_MAGIC && header->text_end % PAGE_SIZE == 0
+        && header->stack_size % PAGE_SIZE == 0 && header->memory_size % PAGE_SIZE == 0
+        && header->stack_size < header->memory_size
+        && header->end <= header->memory_size - header->stack_size)
+    {
+        image->text_size = header->text_end < size ? header->text_end : size;
+        image->bss_end = header->end;
+        image->stack_size = header->stack_size;
+        image->memory_size = header->memory_size;
+    }
+    return image;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void image_share(image_t *image)
+{
+    image->users++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void image_put(image_t *image)
+{
+    image->users--;
+    if (image->users == 0 && image->stale)
+    {
+        destroy(image);
+    }
+    enforce_budget();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t image_page(image_t *image, uint32_t index)
+{
+    if (index >= image->nb_pages)
+    {
+        return 0;
+    }
+    if (image->frames[index] != 0)
+    {
+        nb_page_hits++;
+        return image->frames[index];
+    }
+
+    // Make room for the page, the images in use can't be evicted
+    if (nb_cached_pages >= IMAGE_CACHE_PAGES)
+    {
+        evict_one();
+    }
+    uint32_t frame = frame_alloc();
+    while (frame == 0 && evict_one())
+    {
+        frame = frame_alloc();
+    }
+    if (frame == 0)
+    {
+        return 0;
+    }
+
+    // The end of the last page stays zeroed, it is the beginning of the bss
+    memset((void*)frame, 0, PAGE_SIZE);
+    if (file_read_at(&image->file, (void*)frame, index * PAGE_SIZE, PAGE_SIZE) == -1)
+    {
+        frame_free(frame);
+        return 0;
+    }
+
+    image->frames[index] = frame;
+    image->nb_loaded++;
+    nb_cached_pages++;
+    nb_page_misses++;
+    return frame;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void image_invalidate(uint32_t file_index)
+{
+    for (image_t *image = images; image != NULL; image = image->next)
+    {
+        if (!image->stale && image->file.index == file_index)
+        {
+            image->stale = true;
+            if (image->users == 0)
+            {
+                destroy(image);
+            }
+            return;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void image_cache_dump_stats()
+{
+    printf("image\tsize\ttext\tmemory\tpages\tloaded\tusers\n");
+    for (image_t *image = images; image != NULL; image = image->next)
+    {
+        printf("%u\t%u\t%u\t%u\t%u\t%u\t%u%s\n", image->file.index, image->size, image->text_size,
+               image->memory_size, image->nb_pages, image->nb_loaded, image->users,
+               image->stale ? " (removed)" : "");
+    }
+    printf("image cache: %u/%u pages, launches: %u hits %u misses, pages: %u hits %u misses, %u evictions\n",
+           nb_cached_pages, IMAGE_CACHE_PAGES, nb_exec_hits, nb_exec_misses, nb_page_hits,
+           nb_page_misses, nb_evictions);
+}
@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file image.h
+/// \brief Declaration of the executable image cache.
+///
+/// The cache keeps the pages of the recently executed files in memory, keyed by their
+/// file entry and size. The page fault handler maps the cached pages read-only in the
+/// tasks (see paging.c): the code pages stay shared by all the instances of a program and
+/// a task writing to a data page gets a private copy. Launching a program again therefore
+/// reads nothing from the disk as long as its pages are cached.
+///
+/// The images that no task runs are evicted, least recently used first, when the cached
+/// pages exceed IMAGE_CACHE_KB kilobytes (set in the makefile).
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _IMAGE_H_
+#define _IMAGE_H_
+
+#include "../common/types.h"
+#include "pfs.h"
+
+#ifndef IMAGE_CACHE_KB
+#define IMAGE_CACHE_KB  1024
+#endif
+
+#define IMAGE_MAGIC         0x31505041  // "APP1"
+#define IMAGE_HEADER_OFFSET 4           // After the jump of the entry point
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct image_header_t
+/// \brief Header of the user programs, written by user/app_stub.s.
+///
+/// The code and read-only data end on a page boundary (user/app.ld): these pages are
+/// mapped read-only and shared by all the instances of the program, while the data pages
+/// are shared until an instance writes to them. Programs without header are entirely
+/// copy on write.
+///
+/// The header also declares the memory of the task: the heap grows after the bss and the
+/// stack is at the top of the memory, whose size bounds the segments of the task.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct __attribute__((packed)) image_header_st {
+    uint32_t magic;
+    uint32_t text_end;      ///< End of the code and read-only data, page aligned
+    uint32_t end;           ///< End of the bss
+    uint32_t stack_size;    ///< Size of the stack, page aligned
+    uint32_t memory_size;   ///< Size of the task memory, page aligned
+} image_header_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct image_t
+/// \brief The cached pages of an executable file.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct image_st {
+    file_iterator_t  file;          ///< File entry of the executable
+    uint32_t         size;          ///< Size of the file
+    uint32_t         text_size;     ///< Size of the read-only part, 0 without header
+    uint32_t         bss_end;       ///< End of the bss, 0 without header
+    uint32_t         stack_size;    ///< Declared stack size, 0 without header
+    uint32_t         memory_size;   ///< Declared task memory size, 0 without header
+    uint32_t         nb_pages;
+    uint32_t        *frames;        ///< Frame of each page, 0 until the page is read
+    uint32_t         nb_loaded;     ///< Pages read from the file
+    uint32_t         users;         ///< Tasks running the image
+    uint32_t         last_use;      ///< Value of the use counter at the last launch
+    bool             stale;         ///< The file was removed, freed when unused
+    struct image_st *next;
+} image_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn image_t* image_get(file_iterator_t *file, uint32_t size)
+/// \brief Returns the image of a file, creating it if it isn't cached.
+///
+/// The image is used until image_put() is called. Only the first page, containing the
+/// header, is read by this function.
+///
+/// \param file : Iterator bound to the executable file.
+/// \param size : Size of the file.
+/// \return The image or NULL if there isn't enough memory.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern image_t* image_get(file_iterator_t *file, uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void image_share(image_t *image)
+/// \brief Adds a user to an image, for a task created by fork(). Released by image_put().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void image_share(image_t *image);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void image_put(image_t *image)
+/// \brief Releases an image returned by image_get(). It stays cached if the budget allows.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void image_put(image_t *image);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t image_page(image_t *image, uint32_t index)
+/// \brief Returns the frame holding a page of an image, reading it from the file if
+///        needed. The frame belongs to the cache and must only be mapped read-only.
+/// \return The frame or 0 if there is no free frame or the file can't be read.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t image_page(image_t *image, uint32_t index);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void image_invalidate(uint32_t file_index)
+/// \brief Drops the cached image of a file entry, to be called before the file is removed.
+///
+/// An image still in use is kept for its tasks but won't be returned by image_get().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void image_invalidate(uint32_t file_index);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void image_cache_dump_stats()
+/// \brief Prints the cached images and the hit/miss counters of the cache.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void image_cache_dump_stats();
+
+#endif
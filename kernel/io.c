@@ -9,6 +9,7 @@
 
 #include "io.h"
 #include "periph.h"
+#include "serial.h"
 #include "../common/common_io.h"
 
 //////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
@@ -17,6 +18,7 @@ static uint16_t *display = (uint16_t*)TEXT_DISPLAY_ADDR; ///< Pointer to the dis
 static uint8_t text_color;          ///< Color for the printed text
 static uint8_t background_color;    ///< Background color for the printed text
 static uint16_t cursor_offset;      ///< Cursor offset
+static uint8_t console_output = CONSOLE_VGA | CONSOLE_SERIAL;  ///< Outputs of the print functions
 
 /////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
 
@@ -143,9 +145,22 @@ void get_cursor_position(uint8_t *line, uint8_t *column)
     *column = cursor_offset % TEXT_DISPLAY_COLUMNS;
 }
 
+////////////////////////////////////// CONSOLE OUTPUT ////////////////////////////////////
+
+void set_console_output(uint8_t outputs)
+{
+    console_output = outputs;
+}
+
+uint8_t get_console_output()
+{
+    return console_output;
+}
+
 /////////////////////////////////// TEXT OUTPUT FUNCTIONS ////////////////////////////////
 
-void print_char(char c)
+// Prints a character in the VGA text memory.
+static void vga_print_char(char c)
 {
     uint16_t new_cursor_offset;
 
@@ -180,6 +195,18 @@ void print_char(char c)
 	set_cursor_offset(new_cursor_offset);
 }
 
+void print_char(char c)
+{
+    if (console_output & CONSOLE_VGA)
+    {
+        vga_print_char(c);
+    }
+    if (console_output & CONSOLE_SERIAL)
+    {
+        serial_put_char(c);
+    }
+}
+
 void print_str(char *str)
 {
     // Prints each character of the string
@@ -35,6 +35,10 @@
 #define TEXT_DISPLAY_COLUMNS    80
 #define TEXT_DISPLAY_SIZE       (TEXT_DISPLAY_LINES * TEXT_DISPLAY_COLUMNS)
 
+// Outputs of the console (can be combined)
+#define CONSOLE_VGA             0x1
+#define CONSOLE_SERIAL          0x2
+
 #define CURSOR_COMMAND          0x3D4
 #define CURSOR_DATA             0x3D5
 #define CURSOR_START            0xA
@@ -150,6 +154,27 @@ extern void set_cursor_position(uint8_t line, uint8_t column);
 //////////////////////////////////////////////////////////////////////////////////////////
 extern void get_cursor_position(uint8_t *line, uint8_t *column);
 
+////////////////////// CONSOLE OUTPUT FUNCTIONS ///////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void set_console_output(uint8_t outputs)
+/// \brief Selects where the text output functions print.
+///
+/// The print functions (print_char, print_str, printf...) write to the VGA text display,
+/// the serial port, or both. Both are selected by default. Colors and cursor functions
+/// only apply to the VGA display.
+///
+/// \param outputs : Combination of CONSOLE_VGA and CONSOLE_SERIAL.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void set_console_output(uint8_t outputs);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint8_t get_console_output()
+/// \brief Returns the outputs selected with set_console_output.
+/// \return Combination of CONSOLE_VGA and CONSOLE_SERIAL.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint8_t get_console_output();
+
 ////////////////////// TEXT OUTPUT FUNCTIONS ////////////////////////
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -157,7 +182,8 @@ extern void get_cursor_position(uint8_t *line, uint8_t *column);
 /// \brief Prints a character on the screen.
 ///
 /// Prints the given character on the screen where the cursor is and moves the cursor to
-/// the right.
+/// the right. The character is also sent on the serial port if it is selected with
+/// set_console_output.
 ///
 /// \param c : The character to be printed.
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -209,6 +235,7 @@ extern void print_hex(uint32_t n);
 ///     %c : Character
 ///     %s : String
 ///     %d : Signed integer
+///     %u : Unsigned integer
 ///     %x : Hexadecimal unsigned integer
 ///     %% : Escape the % character
 ///
@@ -0,0 +1,286 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file ipc.c
+/// \brief Implementation of the message passing ports.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ipc.h"
+
+#include "gdt.h"
+#include "paging.h"
+#include "../common/syscall_nb.h"
+
+typedef struct port_st {
+    task_t *creator;            // NULL for a free port
+    task_t *receiver;           // Task waiting in ipc_receive()
+    task_t *first_sender;       // Tasks waiting in ipc_send(), first come first served
+    task_t *last_sender;
+} port_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static port_t ports[IPC_MAX_PORTS];
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Returns the port or NULL if it doesn't exist.
+static port_t* get_port(uint32_t port)
+{
+    return port < IPC_MAX_PORTS && ports[port].creator != NULL ? &ports[port] : NULL;
+}
+
+// Returns whether the pages are in the memory of the task, after its executable whose
+// pages belong to the image cache.
+static bool valid_pages(task_t *task, uint32_t pages)
+{
+    uint32_t address = IPC_PAGES_ADDRESS(pages);
+    uint32_t end = address + IPC_PAGES_COUNT(pages) * PAGE_SIZE;
+    uint32_t image_end = task->image != NULL ? (task->image->size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1) : 0;
+
+    return IPC_PAGES_COUNT(pages) == 0 || (address >= image_end && end <= task->memory_size);
+}
+
+// Moves as many pages as the window holds from a task to another one. Returns the pages
+// mapped in the window.
+static uint32_t move_pages(task_t *from, uint32_t pages, task_t *to, uint32_t window)
+{
+    uint32_t count = IPC_PAGES_COUNT(pages);
+    if (count > IPC_PAGES_COUNT(window))
+    {
+        count = IPC_PAGES_COUNT(window);
+    }
+    if (count == 0 || !paging_move_pages(from->tss.cr3, PAGING_USER_BASE + IPC_PAGES_ADDRESS(pages),
+                                         to->tss.cr3, PAGING_USER_BASE + IPC_PAGES_ADDRESS(window), count))
+    {
+        return 0;
+    }
+    return IPC_PAGES(IPC_PAGES_ADDRESS(window), count);
+}
+
+// Removes a task from the senders waiting on a port, if it is there.
+static void remove_sender(port_t *port, task_t *task)
+{
+    task_t *previous = NULL;
+    for (task_t *sender = port->first_sender; sender != NULL; sender = sender->ipc_next)
+    {
+        if (sender == task)
+        {
+            if (previous != NULL)
+            {
+                previous->ipc_next = sender->ipc_next;
+            }
+            else
+            {
+                port->first_sender = sender->ipc_next;
+            }
+            if (port->last_sender == sender)
+            {
+                port->last_sender = previous;
+            }
+            return;
+        }
+        previous = sender;
+    }
+}
+
+// Gives the message of sender to receiver, which then waits for its reply.
+static void deliver(task_t *sender, task_t *receiver)
+{
+    uint32_t window = receiver->ipc_msg.pages;
+
+    receiver->ipc_msg.data[0] = sender->ipc_msg.data[0];
+    receiver->ipc_msg.data[1] = sender->ipc_msg.data[1];
+    receiver->ipc_msg.pages = move_pages(sender, sender->ipc_msg.pages, receiver, window);
+
+    // The reply pages go back where the lent ones were
+    sender->ipc_lent = IPC_PAGES(IPC_PAGES_ADDRESS(sender->ipc_msg.pages),
+                                 IPC_PAGES_COUNT(receiver->ipc_msg.pages));
+    sender->ipc_replied = false;
+    receiver->ipc_client = sender;
+}
+
+// Ends the call of the client of task, replied or not. A client waiting on a port is
+// called to get the result, the others get it when task blocks or exits.
+static void release_client(task_t *task)
+{
+    task_t *client = task->ipc_client;
+    task->ipc_client = NULL;
+    if (client != NULL && client->blocked)
+    {
+        task_resume(client);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int ipc_port_create()
+{
+    task_t *task = current_task();
+    if (task == NULL)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < IPC_MAX_PORTS; i++)
+    {
+        if (ports[i].creator == NULL)
+        {
+            ports[i].creator = task;
+            ports[i].receiver = NULL;
+            ports[i].first_sender = ports[i].last_sender = NULL;
+            return i;
+        }
+    }
+    return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int ipc_send(uint32_t port, ipc_msg_t *msg)
+{
+    task_t *task = current_task();
+    port_t *p = get_port(port);
+    if (task == NULL || p == NULL || !valid_pages(task, msg->pages))
+    {
+        return -1;
+    }
+    task->ipc_msg = *msg;
+    task->ipc_replied = false;
+
+    if (p->receiver != NULL)
+    {
+        // The receiver runs until it waits again, its reply is ready then. If it waits
+        // for something else, the call fails
+        task_t *receiver = p->receiver;
+        p->receiver = NULL;
+        deliver(task, receiver);
+        if (task_resume(receiver) && receiver->ipc_client == task)
+        {
+            receiver->ipc_client = NULL;
+        }
+    }
+    else
+    {
+        // Called again by the receiver once it replied
+        task->ipc_next = NULL;
+        if (p->last_sender != NULL)
+        {
+            p->last_sender->ipc_next = task;
+        }
+        else
+        {
+            p->first_sender = task;
+        }
+        p->last_sender = task;
+
+        if (!task_block())
+        {
+            remove_sender(p, task);
+            return -1;
+        }
+    }
+
+    if (!task->ipc_replied)
+    {
+        return -1;
+    }
+    *msg = task->ipc_msg;
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int ipc_receive(uint32_t port, ipc_msg_t *msg)
+{
+    task_t *task = current_task();
+    port_t *p = get_port(port);
+    if (task == NULL || p == NULL || p->receiver != NULL || !valid_pages(task, msg->pages))
+    {
+        return -1;
+    }
+
+    // The last message wasn't replied to. Its client may have used the port meanwhile
+    release_client(task);
+    p = get_port(port);
+    if (p == NULL || p->receiver != NULL)
+    {
+        return -1;
+    }
+    task->ipc_msg.pages = msg->pages;
+
+    if (p->first_sender != NULL)
+    {
+        task_t *sender = p->first_sender;
+        p->first_sender = sender->ipc_next;
+        if (p->first_sender == NULL)
+        {
+            p->last_sender = NULL;
+        }
+        deliver(sender, task);
+    }
+    else
+    {
+        // Called again by a sender, which delivered its message
+        p->receiver = task;
+        if (!task_block())
+        {
+            p->receiver = NULL;
+            return -1;
+        }
+    }
+
+    *msg = task->ipc_msg;
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int ipc_reply(uint32_t port, ipc_msg_t *msg)
+{
+    task_t *task = current_task();
+    task_t *client = task != NULL ? task->ipc_client : NULL;
+    if (client == NULL || get_port(port) == NULL || !valid_pages(task, msg->pages))
+    {
+        return -1;
+    }
+
+    client->ipc_msg.data[0] = msg->data[0];
+    client->ipc_msg.data[1] = msg->data[1];
+    client->ipc_msg.pages = move_pages(task, msg->pages, client, client->ipc_lent);
+    client->ipc_replied = true;
+
+    release_client(task);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void ipc_task_exit(task_t *task)
+{
+    for (int i = 0; i < IPC_MAX_PORTS; i++)
+    {
+        port_t *p = &ports[i];
+        if (p->creator == task)
+        {
+            p->creator = NULL;
+            continue;
+        }
+        if (p->receiver == task)
+        {
+            p->receiver = NULL;
+        }
+        remove_sender(p, task);
+    }
+
+    // The servers of the task forget it
+    for (int i = 0; i < MAX_NB_TASKS; i++)
+    {
+        task_t *other = task_at(i);
+        if (other != NULL && other->ipc_client == task)
+        {
+            other->ipc_client = NULL;
+        }
+    }
+
+    // Its client gets an error, a client waiting on a port stays blocked until its
+    // parent exits: the exiting task can't call it
+    if (task->ipc_client != NULL)
+    {
+        task->ipc_client->ipc_replied = false;
+        task->ipc_client = NULL;
+    }
+}
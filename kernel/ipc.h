@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file ipc.h
+/// \brief Declaration of the message passing ports.
+///
+/// A port carries synchronous calls between tasks: a client sends a message and waits
+/// for the reply, a server receives the messages one after the other and replies to
+/// each of them. The messages are small, passed in the registers of the system calls,
+/// and can lend pages: instead of being copied, the pages are unmapped from the sender
+/// and mapped in the receive window of the receiver. The pages of the reply go back to
+/// the address of the lent ones.
+///
+/// The tasks aren't preempted: a task waiting on a port returns to the task which called
+/// it (see task_block()) and the task which sends it a message or replies to it calls it
+/// again. A task can't wait if it is the first one (the shell). The tasks still waiting
+/// when their parent exits are destroyed with it, so are the ports of a task.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _IPC_H_
+#define _IPC_H_
+
+#include "../common/types.h"
+
+#define IPC_MAX_PORTS   64
+
+// Message, see the IPC_PAGES macros of syscall_nb.h for the pages
+typedef struct ipc_msg_st {
+    uint32_t data[2];
+    uint32_t pages;         // Address of the pages in the task memory and their count
+} ipc_msg_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int ipc_port_create()
+/// \brief Creates a port, destroyed when the calling task exits.
+/// \return The number of the port, -1 if there is no free port or no calling task.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int ipc_port_create();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int ipc_send(uint32_t port, ipc_msg_t *msg)
+/// \brief Sends a message and waits for the reply, which replaces it.
+///
+/// The pages of the message are lent to the receiver, as many as its window holds, the
+/// others stay mapped. The pages must be outside of the executable.
+///
+/// \return 0, or -1 if the port or the pages are invalid, if the task can't wait or if
+///         the receiver exited without replying.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int ipc_send(uint32_t port, ipc_msg_t *msg);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int ipc_receive(uint32_t port, ipc_msg_t *msg)
+/// \brief Waits for a message on a port.
+///
+/// A message received before and not replied to is answered with an error.
+///
+/// \param msg : Its pages give the receive window, replaced by the message. The lent
+///        pages are mapped at the start of the window, the pages which were there are
+///        freed.
+/// \return 0, or -1 if the port or the window are invalid, if another task receives on
+///         the port or if the task can't wait.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int ipc_receive(uint32_t port, ipc_msg_t *msg);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int ipc_reply(uint32_t port, ipc_msg_t *msg)
+/// \brief Replies to the last message received.
+///
+/// The pages of the reply are mapped back at the address of the pages lent by the
+/// client, at most as many as it lent. A client waiting on the port is called at once,
+/// a client which called the server gets the reply when the server waits again.
+///
+/// \return 0, or -1 if there is no message to reply to or if the pages are invalid.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int ipc_reply(uint32_t port, ipc_msg_t *msg);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void ipc_task_exit(struct task_st *task)
+/// \brief Destroys the ports of an exiting task and forgets it in the others. Its
+///        clients get an error.
+//////////////////////////////////////////////////////////////////////////////////////////
+struct task_st;
+extern void ipc_task_exit(struct task_st *task);
+
+#endif
@@ -0,0 +1,226 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file irq.c
+/// \brief Implementation of the IRQ dispatch and deferred work functions.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "irq.h"
+
+#include "apic.h"
+#include "io.h"
+#include "sync.h"
+#include "trace.h"
+#include "x86.h"
+
+// Rounds of work items run at the end of an IRQ, the items scheduled again by the last
+// round wait for the next IRQ
+#define WORK_MAX_ROUNDS     8
+
+typedef struct irq_action_st {
+    irq_handler_t handler;
+    void *data;
+    const char *name;
+    uint32_t max_cycles;
+    struct irq_action_st *next;
+} irq_action_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static irq_action_t actions[IRQ_MAX_HANDLERS];
+static uint32_t nb_actions = 0;
+static irq_action_t *lines[IRQ_NB_LINES];
+static irq_stats_t stats[IRQ_NB_LINES];
+
+static spinlock_t work_lock;
+static work_t *pending_work = NULL;     // Last scheduled first
+static bool running_work = false;       // Set while the work items run
+static uint32_t nb_work_runs = 0;
+static uint32_t max_work_cycles = 0;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Runs the scheduled work items, in the order they were scheduled, with the
+// interruptions enabled. Called with the interruptions disabled.
+static void run_work()
+{
+    running_work = true;
+
+    for (int round = 0; round < WORK_MAX_ROUNDS && pending_work != NULL; round++)
+    {
+        spin_lock(&work_lock);
+        work_t *list = pending_work;
+        pending_work = NULL;
+        spin_unlock(&work_lock);
+
+        work_t *ordered = NULL;
+        while (list != NULL)
+        {
+            work_t *next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        sti();
+        for (work_t *work = ordered; work != NULL; )
+        {
+            // The item can be scheduled again as soon as it starts
+            work_t *next = work->next;
+            work->pending = false;
+
+            uint32_t start = (uint32_t)rdtsc();
+            work->function(work->arg);
+            uint32_t cycles = (uint32_t)rdtsc() - start;
+
+            cli();
+            nb_work_runs++;
+            if (cycles > max_work_cycles)
+            {
+                max_work_cycles = cycles;
+            }
+            sti();
+            work = next;
+        }
+        cli();
+    }
+
+    running_work = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+bool irq_register(uint32_t irq, irq_handler_t handler, void *data, const char *name)
+{
+    if (irq >= IRQ_NB_LINES)
+    {
+        return false;
+    }
+
+    uint32_t flags = irq_save();
+    bool registered = nb_actions < IRQ_MAX_HANDLERS;
+    if (registered)
+    {
+        irq_action_t *action = &actions[nb_actions++];
+        action->handler = handler;
+        action->data = data;
+        action->name = name;
+        action->max_cycles = 0;
+        action->next = NULL;
+
+        // Appended, the handlers are called in registration order
+        irq_action_t **last = &lines[irq];
+        while (*last != NULL)
+        {
+            last = &(*last)->next;
+        }
+        *last = action;
+    }
+    irq_restore(flags);
+    return registered;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void irq_handler(regs_t *regs)
+{
+    // The interrupted code had the interruptions enabled, the gate disabled them
+    LATENCY_IRQS_OFF();
+
+    // The local APIC timers tick on every processor, they don't use the tracer nor the
+    // statistics, which aren't shared safely
+    if (regs->number == APIC_TIMER_IRQ)
+    {
+        apic_timer_handler();
+        lapic_eoi();
+        LATENCY_IRQS_ON();
+        return;
+    }
+
+    uint32_t start = (uint32_t)rdtsc();
+    TRACE_EVENT(TRACE_IRQ_ENTRY, regs->number);
+
+    uint32_t irq = regs->number;
+    bool handled = false;
+    for (irq_action_t *action = lines[irq]; action != NULL; action = action->next)
+    {
+        uint32_t handler_start = (uint32_t)rdtsc();
+        handled |= action->handler(regs, action->data);
+        uint32_t cycles = (uint32_t)rdtsc() - handler_start;
+        if (cycles > action->max_cycles)
+        {
+            action->max_cycles = cycles;
+        }
+    }
+    apic_eoi(irq);
+
+    uint32_t cycles = (uint32_t)rdtsc() - start;
+    stats[irq].count++;
+    stats[irq].nb_unhandled += !handled;
+    stats[irq].total_cycles += cycles;
+    if (cycles > stats[irq].max_cycles)
+    {
+        stats[irq].max_cycles = cycles;
+    }
+
+    TRACE_EVENT(TRACE_IRQ_EXIT, irq);
+
+    // Only the outermost IRQ runs the work items
+    if (!running_work && pending_work != NULL)
+    {
+        run_work();
+    }
+
+    // Enabled again by iret
+    LATENCY_IRQS_ON();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void work_init(work_t *work, void (*function)(void*), void *arg)
+{
+    work->function = function;
+    work->arg = arg;
+    work->pending = false;
+    work->next = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void work_schedule(work_t *work)
+{
+    uint32_t flags = spin_lock_irqsave(&work_lock);
+    if (!work->pending)
+    {
+        work->pending = true;
+        work->next = pending_work;
+        pending_work = work;
+    }
+    spin_unlock_irqrestore(&work_lock, flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void irq_get_stats(uint32_t irq, irq_stats_t *result)
+{
+    uint32_t flags = irq_save();
+    *result = stats[irq];
+    irq_restore(flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void irq_dump_stats()
+{
+    printf("irq\tcount\tunhandled\tavg\tmax\thandlers (max)\n");
+    for (uint32_t irq = 0; irq < IRQ_NB_LINES; irq++)
+    {
+        irq_stats_t line;
+        irq_get_stats(irq, &line);
+        if (line.count == 0 && lines[irq] == NULL)
+        {
+            continue;
+        }
+
+        printf("%u\t%u\t%u\t%u\t%u\t", irq, line.count, line.nb_unhandled,
+               line.count != 0 ? div64(line.total_cycles, line.count) : 0, line.max_cycles);
+        for (irq_action_t *action = lines[irq]; action != NULL; action = action->next)
+        {
+            printf("%s (%u) ", action->name, action->max_cycles);
+        }
+        printf("\n");
+    }
+    printf("work items: %u run, max %u cycles\n", nb_work_runs, max_work_cycles);
+}
@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file irq.h
+/// \brief Declaration of the IRQ dispatch and deferred work functions.
+///
+/// The drivers register a handler per IRQ line. A line may be shared: all its handlers
+/// are called in registration order, each one tells whether its device raised the IRQ.
+/// The handlers run with the interruptions disabled, the top half: they only do the
+/// urgent work, such as reading the device, and schedule a work item for the rest.
+///
+/// The work items, the bottom half, run at the end of the outermost IRQ, after its EOI
+/// and with the interruptions enabled. They can be interrupted by the top halves but not
+/// by other work items.
+///
+/// The local APIC timers don't go through the table, see apic.h.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _IRQ_H_
+#define _IRQ_H_
+
+#include "idt.h"
+#include "../common/types.h"
+
+#define IRQ_NB_LINES        16      // ISA IRQs
+#define IRQ_MAX_HANDLERS    16      // For all the lines
+
+// A top half, returns true if its device raised the IRQ
+typedef bool (*irq_handler_t)(regs_t *regs, void *data);
+
+typedef struct work_st {
+    void (*function)(void *arg);
+    void *arg;
+    volatile bool pending;          // Scheduled and not started yet
+    struct work_st *next;
+} work_t;
+
+// Cost of an IRQ line, from the entry of irq_handler() to the end of the EOI
+typedef struct irq_stats_st {
+    uint32_t count;
+    uint32_t nb_unhandled;          // Claimed by no handler
+    uint64_t total_cycles;
+    uint32_t max_cycles;
+} irq_stats_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool irq_register(uint32_t irq, irq_handler_t handler, void *data, const char *name)
+/// \brief Adds a handler to an IRQ line.
+/// \param data : Argument of the handler.
+/// \param name : Name of the handler in the statistics.
+/// \return false if the line doesn't exist or if there are too many handlers.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern bool irq_register(uint32_t irq, irq_handler_t handler, void *data, const char *name);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void irq_handler(regs_t *regs)
+/// \brief Calls the handlers of an IRQ, acknowledges it then runs the pending work
+///        items. Called by the IRQ wrapper (see idt_asm.s).
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void irq_handler(regs_t *regs);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void work_init(work_t *work, void (*function)(void*), void *arg)
+/// \brief Initializes a work item.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void work_init(work_t *work, void (*function)(void*), void *arg);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void work_schedule(work_t *work)
+/// \brief Runs a work item at the end of the current or next IRQ.
+///
+/// Scheduling an item which didn't start yet has no effect: it runs once.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void work_schedule(work_t *work);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void irq_get_stats(uint32_t irq, irq_stats_t *stats)
+/// \brief Copies the statistics of an IRQ line.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void irq_get_stats(uint32_t irq, irq_stats_t *stats);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void irq_dump_stats()
+/// \brief Prints the statistics of the IRQ lines, of their handlers and of the work
+///        items. The times are in cycles.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void irq_dump_stats();
+
+#endif
@@ -9,25 +9,51 @@
 #include "kernel.h"
 
 #include "gdt.h"
+#include "frame.h"
+#include "kmalloc.h"
+#include "paging.h"
 #include "idt.h"
 #include "periph.h"
 #include "io.h"
 #include "pic.h"
+#include "apic.h"
 #include "x86.h"
 #include "keyboard.h"
 #include "timer.h"
+#include "profiler.h"
+#include "latency.h"
 #include "pfs.h"
+#include "serial.h"
+#include "smp.h"
 
 #ifdef TEST
 #include "test.h"
 #endif
 
+#ifdef BENCH
+#include "bench.h"
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////////////
-void runKernel()
+void runKernel(uint32_t magic, multiboot_info_t *info)
 {
-    // Initializing the GDT
+    // Without a multiboot compliant bootloader, the information can't be trusted
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC)
+    {
+        info = NULL;
+    }
+
+    // Initializing the frame allocator, the kernel heap and enabling paging
+    frame_init(info);
+    kmalloc_init();
+    paging_init();
+
+    // Initializing the GDT, the task descriptors are allocated on the heap
     gdt_init();
 
+    // Initializing the serial port (COM1), the console prints there too
+    serial_init();
+
     // Initializing the screen
     init_display();
 
@@ -37,8 +63,11 @@ void runKernel()
     // Initializing the IDT
     idt_init();
 
-    // Initializing timer @ 100Hz
+    // Initializing timer @ 100Hz, the profiler samples at each tick. The latency of its
+    // IRQ is measured by the first handler
+    latency_init();
     timer_init(100);
+    profiler_init();
 
     // Initializing the keyboard);
     keyboard_init();
@@ -46,14 +75,27 @@ void runKernel()
     // Init the file system superblock
     superblock_init();
 
+    // Routing the IRQs through the I/O APIC, if there is one
+    apic_init();
+
     // Enables hardware interruptions
     sti();
 
+    // Starting the local APIC timer and the other processors, they are calibrated with
+    // the timer
+    apic_timer_init();
+    smp_init();
+
     #ifdef TEST
 
     // Runs the test procedure if test mode is enabled
     runFileSystemTests();
 
+    #elif defined(BENCH)
+
+    // Runs the benchmark suite if bench mode is enabled
+    runBenchmarks();
+
     #else
 
     // Executing the Shell
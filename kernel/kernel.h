@@ -9,14 +9,21 @@
 #ifndef _KERNEL_H_
 #define _KERNEL_H_
 
+#include "multiboot.h"
+
 //////////////////////////////////////////////////////////////////////////////////////////
-/// \fn void runKernel()
+/// \fn void runKernel(uint32_t magic, multiboot_info_t *info)
 /// \brief Main kernel function.
 ///
 /// This function is called by the bootloader. It should never return.
-/// If the kernel is compiled in test mode, the test procedure is executed.
+/// If the kernel is compiled in test mode, the test procedure is executed. If it is
+/// compiled in bench mode, the benchmark suite is executed.
+///
+/// \param magic : MULTIBOOT_BOOTLOADER_MAGIC if the kernel was loaded by a multiboot
+///                compliant bootloader.
+/// \param info : Multiboot information, gives the memory map.
 //////////////////////////////////////////////////////////////////////////////////////////
-extern void runKernel();
+extern void runKernel(uint32_t magic, multiboot_info_t *info);
 
 #endif
 
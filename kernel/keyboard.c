@@ -11,22 +11,54 @@
 #include "../common/types.h"
 #include "x86.h"
 #include "io.h"
+#include "irq.h"
 #include "periph.h"
+#include "ring.h"
+#include "sync.h"
 
 #define SHIFT_CODE  0x2A
-#define BUFFER_SIZE 2048
+#define BUFFER_SIZE 2048    // Power of two (see ring.h)
+#define ECHO_SIZE   64      // Characters echoed at once by keyboard_read_line()
+#define SCAN_CODES_SIZE 64  // Power of two
 
 //////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
 
+// Scan codes read by the interruption routine, decoded by a work item (see irq.h)
+static uint8_t scan_codes[SCAN_CODES_SIZE];
+static ring_t scan_code_ring = RING_INIT(scan_codes);
+static work_t decode_work;
+
+// Filled by the work item of the keyboard and by the serial interruption routine, with
+// the interruptions disabled, and emptied by the tasks
 static char buffer[BUFFER_SIZE];
-static uint16_t read_pointer = 0;
-static uint16_t write_pointer = 0;
+static ring_t ring = RING_INIT(buffer);
+static wait_queue_t readers;            // Tasks waiting in keyboard_read()
+static uint32_t nb_dropped = 0;         // Characters typed while the buffer was full
+static uint32_t nb_reported = 0;        // Dropped characters already reported
 
 static char swissKeyboardShift[] = "--+\"*c%&/()=?`\b\tQWERTZUIOPu!\n-ASDFGHJKLoa?-?YXCVBNM;:_--- -------------------";
 static char swissKeyboard[] =       "--1234567890'^\b\tqwertzuiope?\n-asdfghjklea--$yxcvbnm,.---- -------------------";
 
 /////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
 
+// Sleeps until a character is available, then prints the error message of the
+// characters dropped since the last call.
+static void wait_characters()
+{
+    wait_event(&readers, !ring_empty(&ring));
+
+    if (nb_dropped != nb_reported)
+    {
+        nb_reported = nb_dropped;
+        uint8_t text_color = get_text_color();
+        uint8_t background_color = get_background_color();
+        set_colors(RED, BLACK);
+        printf("\r\n***Keyboard buffer is full***");
+        set_colors(text_color, background_color);
+        printf("\r\n");
+    }
+}
+
 // Translates a key code to a character using the swiss keyboard layout.
 static inline char keyboardToChar(uint8_t key_code, bool shift)
 {
@@ -36,82 +68,152 @@ static inline char keyboardToChar(uint8_t key_code, bool shift)
         return swissKeyboardShift[key_code];
 }
 
-// Adds a character to the keyboard buffer.
-static void putCharInBuffer(char c)
+// Translates the scan codes read by keyboard_handler() to characters.
+static void decode_scan_codes(void *arg)
 {
-    // If the buffer is full, prints an error message
-    if (read_pointer == (write_pointer + 1) % BUFFER_SIZE)
+    (void)arg;
+    static bool shift = false;
+    uint8_t key_code;
+
+    while (ring_get(&scan_code_ring, &key_code))
     {
-        uint8_t text_color = get_text_color();
-        uint8_t background_color = get_background_color();
-        set_colors(RED, BLACK);
-        printf("\r\n***Keyboard buffer is full***");
-        set_colors(text_color, background_color);
-        printf("\r\n");
+        // If key is released (break code)
+        if (key_code & (1 << 7))
+        {
+            // If "shift" is released
+            if (key_code == (SHIFT_CODE + (1 << 7)))
+            {
+                shift = false;
+            }
+        }
+        else // Else if key is pressed
+        {
+            // If "shift" is pressed
+            if (key_code == SHIFT_CODE)
+            {
+                shift = true;
+            }
+            else // Else another key is pressed
+            {
+                char c = keyboardToChar(key_code, shift);
+
+                // Prints only the authorized characters
+                if (c != '-' || key_code == 0x35)
+                {
+                    keyboard_put_char(c);
+
+                    #ifdef DEBUG
+                    printf("%c",c);
+                    #endif
+                }
+            }
+        }
     }
-    else
+}
+
+// Keyboard interruption routine, reads the scan code and defers its translation.
+static bool keyboard_handler(regs_t *regs, void *data)
+{
+    (void)regs;
+    (void)data;
+
+    uint8_t key_code = inb(0x60);
+    if (!ring_put(&scan_code_ring, key_code))
     {
-        buffer[write_pointer] = c;
-        write_pointer = (write_pointer + 1) % BUFFER_SIZE;
+        nb_dropped++;
     }
+    work_schedule(&decode_work);
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
-void keyboard_init() { }
+void keyboard_put_char(char c)
+{
+    // The producers are serialized, the error message is printed by the reader
+    uint32_t flags = irq_save();
+    nb_dropped += !ring_put(&ring, (uint8_t)c);
+    irq_restore(flags);
+    wake_up(&readers);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void keyboard_init()
+{
+    wait_queue_init(&readers, "keyboard");
+    work_init(&decode_work, decode_scan_codes, NULL);
+    irq_register(1, keyboard_handler, NULL, "keyboard");
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////
 void keyboard_flush_buffer()
 {
-    read_pointer = write_pointer = 0;
+    ring_clear(&ring);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
-void keyboard_handler()
+uint32_t keyboard_read(char *characters, uint32_t size)
 {
-    static bool shift = false;
-    uint8_t key_code = inb(0x60);
+    wait_characters();
+    return ring_read(&ring, characters, size);
+}
 
-    // If key is released (break code)
-    if (key_code & (1 << 7))
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t keyboard_read_line(char *line, uint32_t size)
+{
+    if (size == 0)
     {
-        // If "shift" is released
-        if (key_code == (SHIFT_CODE + (1 << 7)))
-        {
-            shift = false;
-        }
+        return 0;
     }
-    else // Else if key is pressed
+
+    uint32_t length = 0;
+    bool done = size == 1;
+    while (!done)
     {
-        // If "shift" is pressed
-        if (key_code == SHIFT_CODE)
-        {
-            shift = true;
-        }
-        else // Else another key is pressed
-        {
-            char c = keyboardToChar(key_code, shift);
+        wait_characters();
 
-            // Prints only the authorized characters
-            if (c != '-' || key_code == 0x35)
+        // Edits the line with every available character, their echo is printed at once
+        char echo[ECHO_SIZE + 1];
+        uint32_t nb_echoed = 0;
+        uint8_t c;
+        while (!done && nb_echoed < ECHO_SIZE && ring_get(&ring, &c))
+        {
+            switch (c)
             {
-                putCharInBuffer(c);
-
-                #ifdef DEBUG
-                printf("%c",c);
-                #endif
+            case '\n':
+                done = true;
+                break;
+
+            case '\t':
+                break;
+
+            case '\b':     // Erases the last character, if any
+                if (length > 0)
+                {
+                    length--;
+                    echo[nb_echoed++] = '\b';
+                }
+                break;
+
+            default:
+                line[length++] = c;
+                echo[nb_echoed++] = c;
+                done = length == size - 1;
+                break;
             }
         }
+        echo[nb_echoed] = '\0';
+        print_str(echo);
     }
+
+    print_char('\n');
+    line[length] = '\0';
+    return length;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 char getc()
 {
-    // Wait while the buffer is empty
-    while (read_pointer == write_pointer);
-
-    char c = buffer[read_pointer];
-    read_pointer = (read_pointer + 1) % BUFFER_SIZE;
-
+    char c;
+    keyboard_read(&c, 1);
     return c;
 }
@@ -9,28 +9,61 @@
 #ifndef _KEYBOARD_H_
 #define _KEYBOARD_H_
 
+#include "../common/types.h"
+
 //////////////////////////////////////////////////////////////////////////////////////////
 /// \fn void keyboard_init()
 /// \brief Initializes the keyboard.
 ///
-/// This function doesn't do anything.
+/// Initializes the wait queue of keyboard_read() and registers the interruption routine
+/// on IRQ 1. The routine only reads the scan codes, they are translated by a work item
+/// (see irq.h).
 //////////////////////////////////////////////////////////////////////////////////////////
 extern void keyboard_init();
 
 //////////////////////////////////////////////////////////////////////////////////////////
-/// \fn void keyboard_handler()
-/// \brief Keyboard interruption routine.
+/// \fn void keyboard_put_char(char c)
+/// \brief Adds a character to the keyboard buffer.
+///
+/// Used by the keyboard work item and the serial port interruption routine, the producers
+/// of the lock-free buffer (see ring.h) are serialized by disabling the interruptions. If the buffer is full, the character is dropped and
+/// the next keyboard_read() prints an error message.
+///
+/// \param c : The character to be added.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void keyboard_put_char(char c);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t keyboard_read(char *characters, uint32_t size)
+/// \brief Returns the typed characters.
+///
+/// Sleeps until a character is typed (see sync.h), then drains the buffer in one call.
+///
+/// \param characters : Buffer receiving the characters.
+/// \param size : Size of the buffer, at least 1.
+/// \return The number of characters read.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t keyboard_read(char *characters, uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t keyboard_read_line(char *line, uint32_t size)
+/// \brief Reads a line in canonical mode.
+///
+/// The line is edited in the kernel: the characters are echoed, backspace erases the
+/// last one and tabulations are ignored. The line ends with the return key, which isn't
+/// stored, or when the buffer is full. getc() is the raw mode, without echo nor editing.
 ///
-/// This function is called when a keyboard interruption occurs. It fills the keyboard
-/// buffer with typed characters.
+/// \param line : Buffer receiving the line, ended by a null character.
+/// \param size : Size of the buffer.
+/// \return The length of the line.
 //////////////////////////////////////////////////////////////////////////////////////////
-extern void keyboard_handler();
+extern uint32_t keyboard_read_line(char *line, uint32_t size);
 
 //////////////////////////////////////////////////////////////////////////////////////////
 /// \fn char getc()
 /// \brief Returns a typed character.
 ///
-/// Waits until a character is typed then returns it.
+/// Sleeps until a character is typed then returns it (see sync.h).
 //////////////////////////////////////////////////////////////////////////////////////////
 extern char getc();
 
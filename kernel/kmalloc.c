@@ -0,0 +1,306 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file kmalloc.c
+/// \brief Implementation of the kernel heap.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "kmalloc.h"
+
+#include "frame.h"
+#include "io.h"
+#include "sync.h"
+#include "x86.h"
+#include "../common/string.h"
+
+#define OBJECT_ALIGNMENT    8
+
+// Header at the beginning of each slab. Large allocations use it too, with a NULL
+// cache and the order of their block in nb_used.
+struct slab_st {
+    kmem_cache_t *cache;
+    slab_t       *next;
+    slab_t       *prev;
+    void         *free;     // First free object, the others are linked through it
+    uint32_t      nb_used;
+    uint32_t      reserved; // Keeps the objects aligned on 8 bytes
+};
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static kmem_cache_t caches[KMEM_MAX_CACHES];
+static uint32_t nb_caches = 0;
+
+// Caches used by kmalloc(), from KMALLOC_MIN_SIZE to KMALLOC_MAX_CACHED_SIZE
+static kmem_cache_t *size_caches[8];
+static uint32_t nb_size_caches = 0;
+
+static uint32_t nb_large_allocs = 0;
+static uint32_t nb_large_frees = 0;
+static uint32_t nb_large_frames = 0;    // Frames currently used by large allocations
+
+// Protects the caches, their slab lists and the statistics. Taken before the lock of the
+// frame allocator when a slab is added or given back
+static spinlock_t lock;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+static void list_add(slab_t **list, slab_t *slab)
+{
+    slab->prev = NULL;
+    slab->next = *list;
+    if (slab->next != NULL)
+    {
+        slab->next->prev = slab;
+    }
+    *list = slab;
+}
+
+static void list_remove(slab_t **list, slab_t *slab)
+{
+    if (slab->prev != NULL)
+    {
+        slab->prev->next = slab->next;
+    }
+    else
+    {
+        *list = slab->next;
+    }
+    if (slab->next != NULL)
+    {
+        slab->next->prev = slab->prev;
+    }
+}
+
+// Allocates a frame and cuts it into free objects.
+static slab_t* new_slab(kmem_cache_t *cache)
+{
+    slab_t *slab = (slab_t*)frame_alloc();
+    if (slab == NULL)
+    {
+        return NULL;
+    }
+
+    slab->cache = cache;
+    slab->nb_used = 0;
+    slab->free = NULL;
+
+    // Linked from the last object so that the first one is allocated first
+    uint8_t *objects = (uint8_t*)(slab + 1);
+    for (uint32_t i = cache->objects_per_slab; i-- > 0;)
+    {
+        void **object = (void**)(objects + i * cache->object_size);
+        *object = slab->free;
+        slab->free = object;
+    }
+
+    cache->nb_slabs++;
+    return slab;
+}
+
+static slab_t* slab_of(void *object)
+{
+    return (slab_t*)((uint32_t)object & ~(FRAME_SIZE - 1));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void kmalloc_init()
+{
+    char name[KMEM_NAME_SIZE] = "kmalloc-";
+    spinlock_init(&lock, "kmalloc");
+
+    for (uint32_t size = KMALLOC_MIN_SIZE; size <= KMALLOC_MAX_CACHED_SIZE; size *= 2)
+    {
+        itoa(size, name + 8, 10);
+        size_caches[nb_size_caches++] = kmem_cache_create(name, size);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+kmem_cache_t* kmem_cache_create(const char *name, uint32_t size)
+{
+    size = (size + OBJECT_ALIGNMENT - 1) & ~(OBJECT_ALIGNMENT - 1);
+    if (size > KMALLOC_MAX_CACHED_SIZE)
+    {
+        return NULL;
+    }
+    // An object must be able to hold the free list link
+    if (size < sizeof(void*))
+    {
+        size = sizeof(void*);
+    }
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+    if (nb_caches == KMEM_MAX_CACHES)
+    {
+        spin_unlock_irqrestore(&lock, flags);
+        return NULL;
+    }
+    kmem_cache_t *cache = &caches[nb_caches++];
+    memset(cache, 0, sizeof(kmem_cache_t));
+    strncpy(cache->name, name, KMEM_NAME_SIZE - 1);
+    cache->object_size = size;
+    cache->objects_per_slab = (FRAME_SIZE - sizeof(slab_t)) / size;
+    spin_unlock_irqrestore(&lock, flags);
+    return cache;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void* kmem_cache_alloc(kmem_cache_t *cache)
+{
+    uint32_t flags = spin_lock_irqsave(&lock);
+
+    // Partial slabs first, then the spare empty slab, then a new one
+    slab_t *slab = cache->partial;
+    if (slab == NULL)
+    {
+        slab = cache->empty;
+        if (slab != NULL)
+        {
+            cache->empty = NULL;
+        }
+        else if ((slab = new_slab(cache)) == NULL)
+        {
+            cache->nb_failures++;
+            spin_unlock_irqrestore(&lock, flags);
+            return NULL;
+        }
+        list_add(&cache->partial, slab);
+    }
+
+    void **object = slab->free;
+    slab->free = *object;
+    slab->nb_used++;
+    if (slab->free == NULL)
+    {
+        list_remove(&cache->partial, slab);
+        list_add(&cache->full, slab);
+    }
+
+    cache->nb_used++;
+    cache->nb_allocs++;
+    spin_unlock_irqrestore(&lock, flags);
+    return object;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void kmem_cache_free(kmem_cache_t *cache, void *object)
+{
+    slab_t *slab = slab_of(object);
+    if (slab->cache != cache)
+    {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+
+    if (slab->free == NULL)
+    {
+        list_remove(&cache->full, slab);
+        list_add(&cache->partial, slab);
+    }
+    *(void**)object = slab->free;
+    slab->free = object;
+    slab->nb_used--;
+
+    // Keep a single empty slab, the others go back to the frame allocator
+    if (slab->nb_used == 0)
+    {
+        list_remove(&cache->partial, slab);
+        if (cache->empty == NULL)
+        {
+            cache->empty = slab;
+        }
+        else
+        {
+            frame_free((uint32_t)slab);
+            cache->nb_slabs--;
+        }
+    }
+
+    cache->nb_used--;
+    cache->nb_frees++;
+    spin_unlock_irqrestore(&lock, flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void* kmalloc(uint32_t size)
+{
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < nb_size_caches; i++)
+    {
+        if (size <= size_caches[i]->object_size)
+        {
+            return kmem_cache_alloc(size_caches[i]);
+        }
+    }
+
+    // Big blocks come straight from the frame allocator, behind a header
+    uint32_t order = 0;
+    while (order <= FRAME_MAX_ORDER && ((uint32_t)FRAME_SIZE << order) < size + sizeof(slab_t))
+    {
+        order++;
+    }
+    slab_t *header = (slab_t*)frame_alloc_order(order);
+    if (header == NULL)
+    {
+        return NULL;
+    }
+    header->cache = NULL;
+    header->nb_used = order;
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+    nb_large_allocs++;
+    nb_large_frames += 1 << order;
+    spin_unlock_irqrestore(&lock, flags);
+
+    return header + 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void kfree(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    slab_t *slab = slab_of(ptr);
+    if (slab->cache != NULL)
+    {
+        kmem_cache_free(slab->cache, ptr);
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+    nb_large_frees++;
+    nb_large_frames -= 1 << slab->nb_used;
+    spin_unlock_irqrestore(&lock, flags);
+
+    frame_free((uint32_t)slab);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void kmalloc_dump_stats()
+{
+    printf("cache\t\tsize\tslabs\tused\ttotal\tallocs\tfrees\tfailed\n");
+    for (uint32_t i = 0; i < nb_caches; i++)
+    {
+        // Copied, so that the lock isn't held while printing
+        uint32_t flags = spin_lock_irqsave(&lock);
+        kmem_cache_t cache = caches[i];
+        spin_unlock_irqrestore(&lock, flags);
+
+        printf("%s\t%s%u\t%u\t%u\t%u\t%u\t%u\t%u\n", cache.name,
+               strlen(cache.name) < 8 ? "\t" : "", cache.object_size, cache.nb_slabs,
+               cache.nb_used, cache.nb_slabs * cache.objects_per_slab, cache.nb_allocs,
+               cache.nb_frees, cache.nb_failures);
+    }
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+    uint32_t allocs = nb_large_allocs, frees = nb_large_frees, frames = nb_large_frames;
+    spin_unlock_irqrestore(&lock, flags);
+    printf("large blocks: %u allocs, %u frees, %u frames used\n", allocs, frees, frames);
+}
@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file kmalloc.h
+/// \brief Declaration of the kernel heap (slab caches and kmalloc/kfree).
+///
+/// A cache hands out objects of a single size. Its objects live in slabs: frames that
+/// start with a slab_t header followed by as many objects as fit, the free objects
+/// being linked through their first word. The slab of an object is found by rounding its
+/// address down to the frame, so freeing needs no lookup.
+///
+/// kmalloc() serves the small sizes from a set of power-of-two caches and the sizes
+/// above KMALLOC_MAX_CACHED_SIZE directly from the frame allocator.
+///
+/// The caches are protected by a spinlock taken with the interruptions disabled, so the
+/// heap can be used by any processor and by the interruption routines.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _KMALLOC_H_
+#define _KMALLOC_H_
+
+#include "../common/types.h"
+
+#define KMEM_MAX_CACHES         24
+#define KMEM_NAME_SIZE          16
+#define KMALLOC_MIN_SIZE        16
+#define KMALLOC_MAX_CACHED_SIZE 2048
+
+typedef struct slab_st slab_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct kmem_cache_t
+/// \brief A cache of objects of the same size, with its usage statistics.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct kmem_cache_st {
+    char     name[KMEM_NAME_SIZE];
+    uint32_t object_size;       ///< Size of the objects, rounded up to 8 bytes
+    uint32_t objects_per_slab;
+    slab_t  *partial;           ///< Slabs with free and used objects
+    slab_t  *full;              ///< Slabs without free object
+    slab_t  *empty;             ///< At most one slab without used object, kept for reuse
+    uint32_t nb_slabs;
+    uint32_t nb_used;           ///< Objects currently allocated
+    uint32_t nb_allocs;         ///< Allocations since the creation of the cache
+    uint32_t nb_frees;
+    uint32_t nb_failures;       ///< Allocations that failed for lack of memory
+} kmem_cache_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void kmalloc_init()
+/// \brief Creates the caches used by kmalloc(). The frame allocator must be initialized.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void kmalloc_init();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn kmem_cache_t* kmem_cache_create(const char *name, uint32_t size)
+/// \brief Creates a cache of objects of the given size.
+/// \param name : Name shown in the statistics.
+/// \param size : Size of the objects, at most KMALLOC_MAX_CACHED_SIZE.
+/// \return The cache or NULL if the size is too big or there are too many caches.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern kmem_cache_t* kmem_cache_create(const char *name, uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void* kmem_cache_alloc(kmem_cache_t *cache)
+/// \brief Allocates an object from a cache. Its content is undefined.
+/// \return The object or NULL if there is no free frame for a new slab.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void* kmem_cache_alloc(kmem_cache_t *cache);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void kmem_cache_free(kmem_cache_t *cache, void *object)
+/// \brief Gives back an object allocated from the cache.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void kmem_cache_free(kmem_cache_t *cache, void *object);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void* kmalloc(uint32_t size)
+/// \brief Allocates a block of memory of at least size bytes, aligned on 8 bytes.
+/// \return The block or NULL if there isn't enough memory.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void* kmalloc(uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void kfree(void *ptr)
+/// \brief Frees a block allocated by kmalloc(). Does nothing if ptr is NULL.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void kfree(void *ptr);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void kmalloc_dump_stats()
+/// \brief Prints the statistics of every cache and of the large allocations.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void kmalloc_dump_stats();
+
+#endif
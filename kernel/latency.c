@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file latency.c
+/// \brief Implementation of the interruption latency measurement.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "latency.h"
+
+#include "io.h"
+#include "irq.h"
+#include "smp.h"
+#include "timer.h"
+#include "x86.h"
+
+// irq-off regions of a processor, only changed by the processor itself
+typedef struct irqs_off_st {
+    bool off;                   // A region is started
+    uint32_t start;
+    const void *site;
+    uint32_t nb_regions;
+    uint32_t max_cycles;
+    const void *max_site;
+} irqs_off_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static irqs_off_t cpus[MAX_NB_CPUS];
+
+static uint32_t nb_irq_samples = 0;
+static uint64_t irq_total_ns = 0;
+static uint32_t irq_max_ns = 0;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+#ifdef LATENCY
+// First handler of the timer IRQ, which is raised by the timer alone.
+static bool latency_handler(regs_t *regs, void *data)
+{
+    (void)regs;
+    (void)data;
+
+    uint32_t ns = timer_since_tick_ns();
+    nb_irq_samples++;
+    irq_total_ns += ns;
+    if (ns > irq_max_ns)
+    {
+        irq_max_ns = ns;
+    }
+    return false;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void latency_init()
+{
+    #ifdef LATENCY
+    irq_register(0, latency_handler, NULL, "latency");
+    #endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void latency_irqs_off(const void *site)
+{
+    // Doesn't disable the interruptions itself, that would call the hooks again
+    irqs_off_t *cpu = &cpus[smp_cpu_id()];
+    if (!cpu->off)
+    {
+        cpu->off = true;
+        cpu->site = site;
+        cpu->start = (uint32_t)rdtsc();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void latency_irqs_on()
+{
+    uint32_t end = (uint32_t)rdtsc();
+    irqs_off_t *cpu = &cpus[smp_cpu_id()];
+    if (cpu->off)
+    {
+        uint32_t cycles = end - cpu->start;
+        cpu->off = false;
+        cpu->nb_regions++;
+        if (cycles > cpu->max_cycles)
+        {
+            cpu->max_cycles = cycles;
+            cpu->max_site = cpu->site;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void latency_reset()
+{
+    // The other processors may finish a region meanwhile, it is counted or not
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < MAX_NB_CPUS; i++)
+    {
+        cpus[i].nb_regions = 0;
+        cpus[i].max_cycles = 0;
+        cpus[i].max_site = NULL;
+    }
+    nb_irq_samples = 0;
+    irq_total_ns = 0;
+    irq_max_ns = 0;
+    irq_restore(flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void latency_dump()
+{
+    uint32_t tsc_khz = get_tsc_khz();
+
+    // Copied first, printing disables the interruptions too
+    uint32_t flags = irq_save();
+    irqs_off_t copy[MAX_NB_CPUS];
+    for (uint32_t i = 0; i < MAX_NB_CPUS; i++)
+    {
+        copy[i] = cpus[i];
+    }
+    uint32_t samples = nb_irq_samples;
+    uint64_t total_ns = irq_total_ns;
+    uint32_t max_ns = irq_max_ns;
+    irq_restore(flags);
+
+    printf("cpu\tirq-off regions\tmax (cycles)\tmax (us)\tsite\n");
+    for (uint32_t i = 0; i < smp_nb_cpus(); i++)
+    {
+        printf("%u\t%u\t%u\t%u\t%x\n", i, copy[i].nb_regions, copy[i].max_cycles,
+               tsc_khz >= 1000 ? copy[i].max_cycles / (tsc_khz / 1000) : 0,
+               (uint32_t)copy[i].max_site);
+    }
+    printf("timer irq latency: %u samples, avg %u ns, max %u ns\n", samples,
+           samples != 0 ? div64(total_ns, samples) : 0, max_ns);
+}
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file latency.h
+/// \brief Declaration of the interruption latency measurement.
+///
+/// Only active when the kernel is built with LATENCY defined (make LATENCY=1), otherwise
+/// the hooks expand to nothing (see x86.h) and nothing is measured.
+///
+/// Two figures are kept:
+/// - the irq-off regions, per processor: from the cli (or irq_save()) which disables the
+///   interruptions to the sti which enables them again, including the interruption and
+///   exception routines entered with the interruptions enabled. The longest region and
+///   the address of the code which started it are kept;
+/// - the latency of the timer IRQ, from the tick raised by the PIT to the first handler
+///   of IRQ 0, read from the PIT counter. It includes the irq-off region the tick fell
+///   in, the IRQ controller and the entry of the routine.
+///
+/// The times are measured with the TSC.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include "../common/types.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void latency_init()
+/// \brief Registers the timer IRQ latency sampling, before the timer so that it is the
+///        first handler of IRQ 0. Does nothing without LATENCY.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void latency_init();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void latency_irqs_off(const void *site)
+/// \brief Starts an irq-off region on the calling processor, unless one is started.
+///        Called with the interruptions disabled, through LATENCY_IRQS_OFF().
+/// \param site : Code address reported if the region is the longest.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void latency_irqs_off(const void *site);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void latency_irqs_on()
+/// \brief Ends the irq-off region of the calling processor, if one is started. Called
+///        just before the interruptions are enabled, through LATENCY_IRQS_ON().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void latency_irqs_on();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void latency_reset()
+/// \brief Clears the measures.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void latency_reset();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void latency_dump()
+/// \brief Prints the longest irq-off region of each processor and the latency of the
+///        timer IRQ.
+///
+/// The sites are kernel addresses, addr2line -e kernel/kernel.elf gives their lines.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void latency_dump();
+
+#endif
@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file multiboot.h
+/// \brief Structures passed by a multiboot compliant bootloader (GRUB).
+///
+/// Only the fields used by the kernel are described, see the Multiboot Specification
+/// version 0.6.96 for the complete information structure.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _MULTIBOOT_H_
+#define _MULTIBOOT_H_
+
+#include "../common/types.h"
+
+// Value of eax when the bootloader jumps to the kernel
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002
+
+// Flags of multiboot_info_t telling which fields are valid
+#define MULTIBOOT_INFO_MEMORY       0x001   // mem_lower and mem_upper
+#define MULTIBOOT_INFO_MEM_MAP      0x040   // mmap_length and mmap_addr
+
+// Type of the memory regions that can be used by the kernel
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct multiboot_info_t
+/// \brief Beginning of the multiboot information structure.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct __attribute__((packed)) multiboot_info_st {
+    uint32_t flags;
+    uint32_t mem_lower;         ///< Memory below 1 MB [KB]
+    uint32_t mem_upper;         ///< Memory above 1 MB, up to the first hole [KB]
+    uint32_t boot_device;
+    uint32_t cmdline;
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;       ///< Size of the memory map [bytes]
+    uint32_t mmap_addr;         ///< Address of the first multiboot_mmap_entry_t
+} multiboot_info_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct multiboot_mmap_entry_t
+/// \brief A region of the memory map.
+///
+/// The size field doesn't count itself: the next entry is at size + 4 bytes.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct __attribute__((packed)) multiboot_mmap_entry_st {
+    uint32_t size;
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;
+} multiboot_mmap_entry_t;
+
+#endif
@@ -0,0 +1,405 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file paging.c
+/// \brief Implementation of the paging functions.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "paging.h"
+
+#include "frame.h"
+#include "gdt.h"
+#include "image.h"
+#include "x86.h"
+#include "../common/string.h"
+
+#define PAGE_ENTRIES        1024
+#define LARGE_PAGE_SIZE     0x400000
+#define PAGE_FLAGS_MASK     0xFFF
+
+#define DIRECTORY_INDEX(address)    ((address) >> 22)
+#define TABLE_INDEX(address)        (((address) >> 12) & (PAGE_ENTRIES - 1))
+
+#define CR0_PAGING          0x80000000
+#define CR0_WRITE_PROTECT   0x00010000
+#define CR4_LARGE_PAGES     0x00000010
+
+#define PAGE_WRITE_THROUGH  0x008
+#define PAGE_NO_CACHE       0x010
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static uint32_t kernel_directory[PAGE_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Returns a zeroed frame or 0 if there is no free frame.
+static uint32_t alloc_zeroed_frame()
+{
+    uint32_t frame = frame_alloc();
+    if (frame != 0)
+    {
+        memset((void*)frame, 0, PAGE_SIZE);
+    }
+    return frame;
+}
+
+// Returns the page table entry of address in the directory, creating the page table if
+// needed. Returns NULL if there is no free frame.
+static uint32_t* page_entry(uint32_t *directory, uint32_t address)
+{
+    uint32_t *entry = &directory[DIRECTORY_INDEX(address)];
+    if (!(*entry & PAGE_PRESENT))
+    {
+        uint32_t table = alloc_zeroed_frame();
+        if (table == 0)
+        {
+            return NULL;
+        }
+        *entry = table | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+    }
+    return &((uint32_t*)(*entry & ~PAGE_FLAGS_MASK))[TABLE_INDEX(address)];
+}
+
+// Replaces the copy on write page mapped by entry with a private writable page.
+static bool copy_on_write(uint32_t *entry, uint32_t address)
+{
+    uint32_t old_frame = *entry & ~PAGE_FLAGS_MASK;
+
+    // The other tasks sharing the frame are gone, it can be written in place
+    if (!(*entry & PAGE_SHARED) && !frame_is_shared(old_frame))
+    {
+        *entry = old_frame | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+        invlpg(address);
+        return true;
+    }
+
+    uint32_t frame = frame_alloc();
+    if (frame == 0)
+    {
+        return false;
+    }
+    memcpy((void*)frame, (void*)old_frame, PAGE_SIZE);
+    if (!(*entry & PAGE_SHARED))
+    {
+        frame_free(old_frame);
+    }
+    *entry = frame | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+    invlpg(address);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void paging_init()
+{
+    // Identity mapping of the kernel memory with 4 MB pages
+    for (uint32_t address = 0; address < PAGING_IDENTITY_SIZE; address += LARGE_PAGE_SIZE)
+    {
+        kernel_directory[DIRECTORY_INDEX(address)] = address | PAGE_PRESENT | PAGE_WRITE | PAGE_LARGE;
+    }
+
+    write_cr3((uint32_t)kernel_directory);
+
+    uint32_t cr4, cr0;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    asm volatile("mov %0, %%cr4" : : "r"(cr4 | CR4_LARGE_PAGES));
+
+    // The kernel also honours read-only pages
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    asm volatile("mov %0, %%cr0" : : "r"(cr0 | CR0_PAGING | CR0_WRITE_PROTECT) : "memory");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t paging_kernel_directory()
+{
+    return (uint32_t)kernel_directory;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t paging_create_directory()
+{
+    uint32_t directory = alloc_zeroed_frame();
+    if (directory != 0)
+    {
+        memcpy((void*)directory, kernel_directory, DIRECTORY_INDEX(PAGING_IDENTITY_SIZE) * sizeof(uint32_t));
+        memcpy((uint32_t*)directory + DIRECTORY_INDEX(PAGING_DEVICE_BASE),
+               &kernel_directory[DIRECTORY_INDEX(PAGING_DEVICE_BASE)],
+               (PAGE_ENTRIES - DIRECTORY_INDEX(PAGING_DEVICE_BASE)) * sizeof(uint32_t));
+    }
+    return directory;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void paging_map_device(uint32_t address)
+{
+    if (address < PAGING_DEVICE_BASE)
+    {
+        return;
+    }
+    uint32_t large_page = address & ~(LARGE_PAGE_SIZE - 1);
+    kernel_directory[DIRECTORY_INDEX(address)] = large_page | PAGE_PRESENT | PAGE_WRITE | PAGE_LARGE
+                                                 | PAGE_WRITE_THROUGH | PAGE_NO_CACHE;
+    invlpg(large_page);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t paging_fork_directory()
+{
+    uint32_t *parent = (uint32_t*)(read_cr3() & ~PAGE_FLAGS_MASK);
+    uint32_t *child = (uint32_t*)paging_create_directory();
+    if (child == NULL)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = DIRECTORY_INDEX(PAGING_USER_BASE); i < DIRECTORY_INDEX(PAGING_DEVICE_BASE); i++)
+    {
+        if (!(parent[i] & PAGE_PRESENT))
+        {
+            continue;
+        }
+
+        uint32_t *child_table = (uint32_t*)alloc_zeroed_frame();
+        if (child_table == NULL)
+        {
+            paging_destroy_directory((uint32_t)child);
+            return 0;
+        }
+        child[i] = (uint32_t)child_table | (parent[i] & PAGE_FLAGS_MASK);
+
+        uint32_t *parent_table = (uint32_t*)(parent[i] & ~PAGE_FLAGS_MASK);
+        for (uint32_t j = 0; j < PAGE_ENTRIES; j++)
+        {
+            // The writable pages become copy on write in both tasks, the frames of the
+            // image cache and of the shared memory regions are simply mapped again
+            if ((parent_table[j] & PAGE_PRESENT) && !(parent_table[j] & PAGE_SHARED))
+            {
+                if ((parent_table[j] & PAGE_WRITE) && !(parent_table[j] & PAGE_SHM))
+                {
+                    parent_table[j] = (parent_table[j] & ~PAGE_WRITE) | PAGE_COW;
+                }
+                frame_share(parent_table[j] & ~PAGE_FLAGS_MASK);
+            }
+            child_table[j] = parent_table[j];
+        }
+    }
+
+    // The parent's pages are now read-only
+    write_cr3(read_cr3());
+    return (uint32_t)child;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void paging_destroy_directory(uint32_t directory)
+{
+    uint32_t *entries = (uint32_t*)directory;
+
+    for (uint32_t i = DIRECTORY_INDEX(PAGING_USER_BASE); i < DIRECTORY_INDEX(PAGING_DEVICE_BASE); i++)
+    {
+        if (!(entries[i] & PAGE_PRESENT))
+        {
+            continue;
+        }
+
+        uint32_t *table = (uint32_t*)(entries[i] & ~PAGE_FLAGS_MASK);
+        for (uint32_t j = 0; j < PAGE_ENTRIES; j++)
+        {
+            if ((table[j] & PAGE_PRESENT) && !(table[j] & PAGE_SHARED))
+            {
+                frame_free(table[j] & ~PAGE_FLAGS_MASK);
+            }
+        }
+        frame_free((uint32_t)table);
+    }
+    frame_free(directory);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+bool paging_handle_fault(regs_t *regs)
+{
+    uint32_t address = read_cr2();
+    uint32_t directory = read_cr3() & ~PAGE_FLAGS_MASK;
+    task_t *task = current_task();
+
+    // Only the pages of the task memory are handled
+    if (directory == (uint32_t)kernel_directory || task == NULL
+        || address < PAGING_USER_BASE || address >= PAGING_USER_BASE + task->memory_size)
+    {
+        return false;
+    }
+
+    uint32_t page = address & ~PAGE_FLAGS_MASK;
+    uint32_t *entry = page_entry((uint32_t*)directory, page);
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    // Write to a copy on write page
+    if (regs->error_code & PAGE_FAULT_PRESENT)
+    {
+        if (!(regs->error_code & PAGE_FAULT_WRITE) || !(*entry & PAGE_COW))
+        {
+            return false;
+        }
+        return copy_on_write(entry, page);
+    }
+
+    // The pages of the executable come from the image cache, the rest (bss, heap, stack)
+    // is zeroed
+    uint32_t offset = page - PAGING_USER_BASE;
+    if (task->image != NULL && offset < task->image->size)
+    {
+        uint32_t frame = image_page(task->image, offset / PAGE_SIZE);
+        if (frame == 0)
+        {
+            return false;
+        }
+
+        // The code stays shared by all the instances of the program
+        if (offset < task->image->text_size)
+        {
+            *entry = frame | PAGE_PRESENT | PAGE_USER | PAGE_SHARED;
+            return !(regs->error_code & PAGE_FAULT_WRITE);
+        }
+
+        // Writing to the read-only page would fault again
+        *entry = frame | PAGE_PRESENT | PAGE_USER | PAGE_SHARED | PAGE_COW;
+        return (regs->error_code & PAGE_FAULT_WRITE) ? copy_on_write(entry, page) : true;
+    }
+
+    // The memory between the heap and the stack of a program with header isn't committed,
+    // touching it is an error
+    uint32_t heap_end = (task->brk + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if (task->image != NULL && task->image->memory_size != 0
+        && offset >= heap_end && offset < task->memory_size - task->stack_size)
+    {
+        return false;
+    }
+
+    uint32_t frame = alloc_zeroed_frame();
+    if (frame == 0)
+    {
+        return false;
+    }
+    *entry = frame | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+bool paging_is_present(uint32_t address)
+{
+    uint32_t *directory = (uint32_t*)(read_cr3() & ~PAGE_FLAGS_MASK);
+    uint32_t entry = directory[DIRECTORY_INDEX(address)];
+
+    if (!(entry & PAGE_PRESENT) || (entry & PAGE_LARGE))
+    {
+        return entry & PAGE_PRESENT;
+    }
+    return ((uint32_t*)(entry & ~PAGE_FLAGS_MASK))[TABLE_INDEX(address)] & PAGE_PRESENT;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void paging_release(uint32_t start, uint32_t end)
+{
+    uint32_t *directory = (uint32_t*)(read_cr3() & ~PAGE_FLAGS_MASK);
+
+    for (uint32_t address = start; address < end; address += PAGE_SIZE)
+    {
+        uint32_t entry = directory[DIRECTORY_INDEX(address)];
+        if (address < PAGING_USER_BASE || !(entry & PAGE_PRESENT))
+        {
+            continue;
+        }
+
+        uint32_t *page = &((uint32_t*)(entry & ~PAGE_FLAGS_MASK))[TABLE_INDEX(address)];
+        if (*page & PAGE_PRESENT)
+        {
+            if (!(*page & PAGE_SHARED))
+            {
+                frame_free(*page & ~PAGE_FLAGS_MASK);
+            }
+            *page = 0;
+            invlpg(address);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+bool paging_move_pages(uint32_t from, uint32_t source, uint32_t to, uint32_t target, uint32_t nb_pages)
+{
+    uint32_t current = read_cr3() & ~PAGE_FLAGS_MASK;
+
+    // The page tables of the target are created first, a missing frame changes nothing
+    for (uint32_t i = 0; i < nb_pages; i++)
+    {
+        if (page_entry((uint32_t*)to, target + i * PAGE_SIZE) == NULL)
+        {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < nb_pages; i++)
+    {
+        uint32_t source_page = source + i * PAGE_SIZE;
+        uint32_t target_page = target + i * PAGE_SIZE;
+
+        uint32_t table = ((uint32_t*)from)[DIRECTORY_INDEX(source_page)];
+        uint32_t *source_entry = NULL;
+        if (table & PAGE_PRESENT)
+        {
+            source_entry = &((uint32_t*)(table & ~PAGE_FLAGS_MASK))[TABLE_INDEX(source_page)];
+        }
+
+        uint32_t *target_entry = page_entry((uint32_t*)to, target_page);
+        if ((*target_entry & PAGE_PRESENT) && !(*target_entry & PAGE_SHARED))
+        {
+            frame_free(*target_entry & ~PAGE_FLAGS_MASK);
+        }
+
+        // The frame keeps its flags, a copy on write page is still shared
+        *target_entry = source_entry != NULL ? *source_entry : 0;
+        if (source_entry != NULL)
+        {
+            *source_entry = 0;
+        }
+
+        if (from == current)
+        {
+            invlpg(source_page);
+        }
+        if (to == current)
+        {
+            invlpg(target_page);
+        }
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+bool paging_map_shared(uint32_t address, const uint32_t *frames, uint32_t nb_pages)
+{
+    uint32_t *directory = (uint32_t*)(read_cr3() & ~PAGE_FLAGS_MASK);
+
+    // The page tables are created first, a missing frame changes nothing
+    for (uint32_t i = 0; i < nb_pages; i++)
+    {
+        if (page_entry(directory, address + i * PAGE_SIZE) == NULL)
+        {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < nb_pages; i++)
+    {
+        uint32_t page = address + i * PAGE_SIZE;
+        uint32_t *entry = page_entry(directory, page);
+        if ((*entry & PAGE_PRESENT) && !(*entry & PAGE_SHARED))
+        {
+            frame_free(*entry & ~PAGE_FLAGS_MASK);
+        }
+
+        frame_share(frames[i]);
+        *entry = frames[i] | PAGE_PRESENT | PAGE_WRITE | PAGE_USER | PAGE_SHM;
+        invlpg(page);
+    }
+    return true;
+}
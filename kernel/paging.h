@@ -0,0 +1,145 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file paging.h
+/// \brief Declaration of the paging functions.
+///
+/// The first gigabyte of the linear address space is identity mapped with 4 MB pages in
+/// every page directory and is only accessible to the kernel. Each task has its own page
+/// directory in which its memory is mapped at PAGING_USER_BASE, where the segments of
+/// its LDT start. The pages of a task are committed on their first access by the page
+/// fault handler, so a task only uses the frames it actually touches.
+///
+/// The registers of the devices above PAGING_DEVICE_BASE (local APIC) are identity mapped
+/// in every page directory as well, once paging_map_device() was called.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _PAGING_H_
+#define _PAGING_H_
+
+#include "../common/types.h"
+#include "idt.h"
+
+#define PAGE_SIZE               4096
+#define PAGING_IDENTITY_SIZE    0x40000000  // Memory identity mapped for the kernel
+#define PAGING_USER_BASE        0x40000000  // Linear address of the memory of the tasks
+#define PAGING_DEVICE_BASE      0xC0000000  // Memory mapped devices, above the tasks
+
+// Page directory and page table entry flags
+#define PAGE_PRESENT    0x001
+#define PAGE_WRITE      0x002
+#define PAGE_USER       0x004
+#define PAGE_LARGE      0x080   // 4 MB page, page directory entries only
+#define PAGE_SHARED     0x200   // Read-only frame owned by the image cache
+#define PAGE_COW        0x400   // Read-only page copied on the first write
+#define PAGE_SHM        0x800   // Writable frame of a shared memory region, kept by fork
+
+// Page fault error code bits
+#define PAGE_FAULT_PRESENT  0x1     // The page was present (protection violation)
+#define PAGE_FAULT_WRITE    0x2
+#define PAGE_FAULT_USER     0x4
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void paging_init()
+/// \brief Builds the kernel page directory and enables paging.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void paging_init();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t paging_kernel_directory()
+/// \brief Returns the physical address of the page directory used outside of the tasks.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t paging_kernel_directory();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void paging_map_device(uint32_t address)
+/// \brief Identity maps the 4 MB around the registers of a device, uncached.
+///
+/// Only the addresses above PAGING_DEVICE_BASE can be mapped, the directories created
+/// afterwards get the mapping too. Must be called before the first task is created.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void paging_map_device(uint32_t address);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t paging_create_directory()
+/// \brief Creates the page directory of a task, without any user page.
+/// \return The physical address of the directory or 0 if there is no free frame.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t paging_create_directory();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t paging_fork_directory()
+/// \brief Creates a copy of the current page directory for fork().
+///
+/// No page is copied: the user pages are shared by the two directories and the writable
+/// ones become copy on write in both of them.
+///
+/// \return The physical address of the new directory or 0 if there is no free frame.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t paging_fork_directory();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void paging_destroy_directory(uint32_t directory)
+/// \brief Frees a page directory, its page tables and all the user pages mapped in it.
+///
+/// The pages of the image cache aren't freed and the pages shared with another task
+/// (fork) are only freed by their last owner.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void paging_destroy_directory(uint32_t directory);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool paging_handle_fault(regs_t *regs)
+/// \brief Page fault handler.
+///
+/// Maps a zeroed page if the fault is an access to a missing page of the task memory
+/// of the current page directory. If the page is part of the executable of the current
+/// task, the page of the image cache is mapped read-only instead (see image.h). A write
+/// to a copy on write page (data page of the image, page shared by fork) gives the task
+/// a private copy of the page, a write to the code of the image is an error.
+///
+/// \param regs : CPU context saved by the exception wrapper.
+/// \return true if the faulting instruction can be restarted, false if the fault is an
+///         error.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern bool paging_handle_fault(regs_t *regs);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool paging_is_present(uint32_t address)
+/// \brief Returns whether a linear address is mapped in the current page directory.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern bool paging_is_present(uint32_t address);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void paging_release(uint32_t start, uint32_t end)
+/// \brief Unmaps and frees the user pages of the current page directory in [start, end[.
+///
+/// Used when a task shrinks its heap. The bounds are linear addresses rounded to pages.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void paging_release(uint32_t start, uint32_t end);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool paging_move_pages(uint32_t from, uint32_t source, uint32_t to, uint32_t target, uint32_t nb_pages)
+/// \brief Moves user pages from a page directory to another one, without copying them.
+///
+/// The pages at source are unmapped from the directory from, the pages at target in the
+/// directory to are freed and replaced by them. The missing pages stay missing, they
+/// are zeroed on their first access. The pages must not belong to the image cache.
+///
+/// \param from, to : Physical addresses of the directories, possibly the current one.
+/// \param source, target : Linear addresses of the first pages.
+/// \return false if a page table can't be allocated, nothing is moved then.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern bool paging_move_pages(uint32_t from, uint32_t source, uint32_t to, uint32_t target, uint32_t nb_pages);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool paging_map_shared(uint32_t address, const uint32_t *frames, uint32_t nb_pages)
+/// \brief Maps frames writable in the current page directory, each one gaining an owner
+///        (see frame_share()).
+///
+/// The pages at address are freed and replaced. The frames stay shared by the tasks
+/// forked afterwards instead of being copied on write.
+///
+/// \param address : Linear address of the first page.
+/// \return false if a page table can't be allocated, nothing is mapped then.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern bool paging_map_shared(uint32_t address, const uint32_t *frames, uint32_t nb_pages);
+
+#endif
@@ -98,9 +98,15 @@ int file_read(char *filename, void *buf)
     uint32_t nbSectors = ceil(fe->fileSize, SECTOR_SIZE);
     uint32_t nbBlocks = ceil(nbSectors, sb.sectorsPerBlock);
 
+    // Nothing to copy for an empty file
+    if (nbSectors == 0)
+    {
+        return 0;
+    }
+
     uint8_t buffer[SECTOR_SIZE];
-    uint16_t blockIndex;
-    uint32_t j;
+    uint16_t blockIndex = 0;
+    uint32_t j = 0;
 
     // Iterate over the blocks
     for (uint32_t i = 0, sectorCount = 0; i < nbBlocks; i++)
@@ -128,6 +134,53 @@ int file_read(char *filename, void *buf)
     return 0;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+int file_read_at(file_iterator_t *it, void *buf, uint32_t offset, uint32_t count)
+{
+    if (! it->boundToFile)
+    {
+        return -1;
+    }
+
+    // Read the sector of the file entry
+    uint8_t fileEntrySector[SECTOR_SIZE];
+    read_sector(it->sector, fileEntrySector);
+    FileEntry *fe = (FileEntry*)&fileEntrySector[it->indexInSector * sb.fileEntrySize];
+
+    if (offset >= fe->fileSize)
+    {
+        return 0;
+    }
+    if (count > fe->fileSize - offset)
+    {
+        count = fe->fileSize - offset;
+    }
+
+    uint32_t blockSize = sb.sectorsPerBlock * SECTOR_SIZE;
+    uint32_t firstDataBlock = 1 + sb.bitmapSize
+                            + ceil(sb.nbFileEntries * sb.fileEntrySize, blockSize);
+    uint8_t buffer[SECTOR_SIZE];
+
+    // Copy the requested part of each sector
+    for (uint32_t done = 0; done < count; )
+    {
+        uint32_t position = offset + done;
+        uint32_t blockIndex = fe->dataBlocks[position / blockSize] + firstDataBlock;
+        uint32_t inSector = position % SECTOR_SIZE;
+        uint32_t size = SECTOR_SIZE - inSector;
+        if (size > count - done)
+        {
+            size = count - done;
+        }
+
+        read_sector(blockIndex * sb.sectorsPerBlock + (position % blockSize) / SECTOR_SIZE, buffer);
+        memcpy((uint8_t*)buf + done, buffer + inSector, size);
+        done += size;
+    }
+
+    return count;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 int file_remove(char *filename)
 {
@@ -158,16 +211,20 @@ int file_remove(char *filename)
     uint8_t buffer[SECTOR_SIZE];
     for (uint32_t i = 0; i < nbBlocks; ++i)
     {
+        // Each sector of the bitmap holds the bits of 8 * SECTOR_SIZE data blocks
+        uint32_t sector = sb.sectorsPerBlock + fe->dataBlocks[i] / (8 * SECTOR_SIZE);
+        uint32_t byteIndex = (fe->dataBlocks[i] / 8) % SECTOR_SIZE;
+
         // Read the bitmap sector
-        read_sector(sb.sectorsPerBlock + fe->dataBlocks[i] / (8 * SECTOR_SIZE * sb.sectorsPerBlock), buffer);
+        read_sector(sector, buffer);
 
         // Edit the bit
-        uint16_t byte = buffer[fe->dataBlocks[i] / 8];
+        uint16_t byte = buffer[byteIndex];
         byte ^= 1 << (7 - (fe->dataBlocks[i] % 8));
-        buffer[fe->dataBlocks[i] / 8] = byte;
+        buffer[byteIndex] = byte;
 
         // Write the bitmap sector
-        write_sector(sb.sectorsPerBlock + fe->dataBlocks[i] / (8 * SECTOR_SIZE * sb.sectorsPerBlock), buffer);
+        write_sector(sector, buffer);
     }
     return 0;
 }
@@ -104,6 +104,21 @@ extern int file_stat(char *filename, stat_t *stat);
 //////////////////////////////////////////////////////////////////////////////////////////
 extern int file_read(char *filename, void *buf);
 
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn extern int file_read_at(file_iterator_t *it, void *buf, uint32_t offset, uint32_t count)
+/// \brief Reads a part of a file from the file system.
+///
+/// Only the sectors containing the requested bytes are read. The file is designated by
+/// an iterator returned by find_file(), which avoids looking the name up at each call.
+///
+/// \param it : Iterator bound to the file.
+/// \param buf : Buffer in which the bytes are stored.
+/// \param offset : Position of the first byte to read in the file.
+/// \param count : Number of bytes to read, truncated at the end of the file.
+/// \return The number of bytes read or -1 if error.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int file_read_at(file_iterator_t *it, void *buf, uint32_t offset, uint32_t count);
+
 //////////////////////////////////////////////////////////////////////////////////////////
 /// \fn extern int file_remove(char *filename)
 /// \brief Remove a file from the file system.
@@ -35,6 +35,12 @@ void pic_init() {
     outb(PIC2_DATA, 0x01);
 }
 
+// Mask every IRQ of both PICs, the I/O APIC takes over (see apic.c).
+void pic_disable() {
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+}
+
 // Send an EOI to the PICs given which IRQ was handled.
 void pic_eoi(int irq) {
 	// An EOI must also be sent to the slave for IRQs > 7
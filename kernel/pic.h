@@ -2,6 +2,7 @@
 #define _PIC_H_
 
 extern void pic_init();
+extern void pic_disable();
 extern void pic_eoi(int irq);
 
 #endif
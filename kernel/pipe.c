@@ -0,0 +1,344 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file pipe.c
+/// \brief Implementation of the pipes.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "pipe.h"
+
+#include "gdt.h"
+#include "kmalloc.h"
+#include "ring.h"
+#include "../common/syscall_nb.h"
+
+// Tasks waiting on a pipe, first come first served
+typedef struct waiting_st {
+    task_t *first;
+    task_t *last;
+} waiting_t;
+
+typedef struct pipe_st {
+    uint8_t *buffer;            // NULL for a free pipe
+    ring_t ring;
+    task_t *creator;            // Holds both ends until pipe_close(), NULL then
+    uint32_t nb_readers;        // Tasks whose input is the pipe, and the creator
+    uint32_t nb_writers;        // Tasks whose output is the pipe, and the creator
+    waiting_t readers;          // Waiting for data
+    waiting_t writers;          // Waiting for space
+} pipe_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static pipe_t pipes[PIPE_MAX_PIPES];
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Returns the pipe or NULL if it doesn't exist.
+static pipe_t* get_pipe(uint32_t pipe)
+{
+    return pipe < PIPE_MAX_PIPES && pipes[pipe].buffer != NULL ? &pipes[pipe] : NULL;
+}
+
+// Takes a reference to an end of a pipe, if any.
+static void hold(pipe_t *pipe, bool output)
+{
+    if (pipe != NULL)
+    {
+        if (output)
+        {
+            pipe->nb_writers++;
+        }
+        else
+        {
+            pipe->nb_readers++;
+        }
+    }
+}
+
+// Releases a reference to an end of a pipe, if any, and destroys the pipe once nobody
+// uses it.
+static void release(pipe_t *pipe, bool output)
+{
+    if (pipe == NULL)
+    {
+        return;
+    }
+    if (output)
+    {
+        pipe->nb_writers--;
+    }
+    else
+    {
+        pipe->nb_readers--;
+    }
+
+    if (pipe->nb_readers == 0 && pipe->nb_writers == 0)
+    {
+        kfree(pipe->buffer);
+        pipe->buffer = NULL;
+    }
+}
+
+// Removes a task from a waiting list, if it is there.
+static void remove_waiting(waiting_t *waiting, task_t *task)
+{
+    task_t *previous = NULL;
+    for (task_t *other = waiting->first; other != NULL; other = other->pipe_next)
+    {
+        if (other == task)
+        {
+            if (previous != NULL)
+            {
+                previous->pipe_next = other->pipe_next;
+            }
+            else
+            {
+                waiting->first = other->pipe_next;
+            }
+            if (waiting->last == other)
+            {
+                waiting->last = previous;
+            }
+            return;
+        }
+        previous = other;
+    }
+}
+
+// Queues the current task on a pipe until a task calls it: the pipe changed, or its
+// parent waits for it (see wait_task()). Returns false if the task can't wait.
+static bool wait(pipe_t *pipe, waiting_t *waiting, task_t *task)
+{
+    if (task == NULL)
+    {
+        return false;
+    }
+
+    task->pipe_next = NULL;
+    if (waiting->last != NULL)
+    {
+        waiting->last->pipe_next = task;
+    }
+    else
+    {
+        waiting->first = task;
+    }
+    waiting->last = task;
+    task->pipe_wait = pipe;
+
+    bool called = task_block();
+    remove_waiting(waiting, task);
+    task->pipe_wait = NULL;
+    return called;
+}
+
+// Calls the first task of a waiting list, which reads or writes until it waits again or
+// exits. Returns false if no task waits.
+static bool wake_up(waiting_t *waiting)
+{
+    task_t *task = waiting->first;
+    if (task == NULL)
+    {
+        return false;
+    }
+    remove_waiting(waiting, task);
+    task->pipe_wait = NULL;
+    task_resume(task);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_create()
+{
+    task_t *task = current_task();
+    if (task == NULL)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < PIPE_MAX_PIPES; i++)
+    {
+        pipe_t *pipe = &pipes[i];
+        if (pipe->buffer == NULL)
+        {
+            pipe->buffer = kmalloc(PIPE_SIZE);
+            if (pipe->buffer == NULL)
+            {
+                return -1;
+            }
+            ring_init(&pipe->ring, pipe->buffer, PIPE_SIZE);
+            pipe->creator = task;
+            pipe->nb_readers = pipe->nb_writers = 1;
+            pipe->readers.first = pipe->readers.last = NULL;
+            pipe->writers.first = pipe->writers.last = NULL;
+            return i;
+        }
+    }
+    return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_close(uint32_t pipe)
+{
+    pipe_t *p = get_pipe(pipe);
+    if (p == NULL || p->creator == NULL || p->creator != current_task())
+    {
+        return -1;
+    }
+
+    p->creator = NULL;
+    release(p, false);
+    release(p, true);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_redirect(uint32_t pipe, bool output)
+{
+    task_t *task = current_task();
+    pipe_t *p = pipe != (uint32_t)PIPE_CONSOLE ? get_pipe(pipe) : NULL;
+    if (task == NULL || (p == NULL && pipe != (uint32_t)PIPE_CONSOLE))
+    {
+        return -1;
+    }
+
+    // Held before the previous end is released, which may be the same pipe
+    hold(p, output);
+    if (output)
+    {
+        release(task->pipe_out, true);
+        task->pipe_out = p;
+    }
+    else
+    {
+        release(task->pipe_in, false);
+        task->pipe_in = p;
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_read(pipe_t *pipe, void *data, uint32_t size)
+{
+    task_t *task = current_task();
+    while (true)
+    {
+        uint32_t count = ring_read(&pipe->ring, data, size);
+        if (count != 0 || size == 0)
+        {
+            return count;
+        }
+        if (pipe->nb_writers == 0)
+        {
+            return 0;
+        }
+
+        // Empty: a waiting writer fills it, or the task waits for one
+        if (!wake_up(&pipe->writers) && !wait(pipe, &pipe->readers, task))
+        {
+            return -1;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_read_line(pipe_t *pipe, char *line, uint32_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    // The available bytes are copied at once into the line, but only the ones up to the
+    // '\n' are read: the rest stays in the ring for the next read
+    task_t *task = current_task();
+    uint32_t length = 0;
+    while (length < size - 1)
+    {
+        uint32_t count = ring_peek(&pipe->ring, line + length, size - 1 - length);
+        if (count == 0)
+        {
+            // Empty: a waiting writer fills it, or the task waits for one
+            if (pipe->nb_writers == 0 ||
+                (!wake_up(&pipe->writers) && !wait(pipe, &pipe->readers, task)))
+            {
+                line[length] = '\0';
+                return length != 0 ? (int)length : -1;
+            }
+            continue;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (line[length + i] == '\n')
+            {
+                ring_skip(&pipe->ring, i + 1);
+                line[length + i] = '\0';
+                return length + i;
+            }
+        }
+        ring_skip(&pipe->ring, count);
+        length += count;
+    }
+    line[length] = '\0';
+    return length;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_write(pipe_t *pipe, const void *data, uint32_t size)
+{
+    task_t *task = current_task();
+    uint32_t written = 0;
+    while (pipe->nb_readers != 0)
+    {
+        written += ring_write(&pipe->ring, (const uint8_t*)data + written, size - written);
+        if (written == size)
+        {
+            return written;
+        }
+
+        // Full: a waiting reader empties it, or the task waits for one
+        if (!wake_up(&pipe->readers) && !wait(pipe, &pipe->writers, task))
+        {
+            break;
+        }
+    }
+    return written != 0 ? (int)written : -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void pipe_task_inherit(task_t *task, task_t *parent)
+{
+    if (parent != NULL)
+    {
+        task->pipe_in = parent->pipe_in;
+        task->pipe_out = parent->pipe_out;
+        hold(task->pipe_in, false);
+        hold(task->pipe_out, true);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void pipe_task_exit(task_t *task)
+{
+    // A blocked task destroyed with its parent
+    if (task->pipe_wait != NULL)
+    {
+        remove_waiting(&task->pipe_wait->readers, task);
+        remove_waiting(&task->pipe_wait->writers, task);
+        task->pipe_wait = NULL;
+    }
+
+    release(task->pipe_in, false);
+    release(task->pipe_out, true);
+    task->pipe_in = task->pipe_out = NULL;
+
+    for (int i = 0; i < PIPE_MAX_PIPES; i++)
+    {
+        if (pipes[i].buffer != NULL && pipes[i].creator == task)
+        {
+            pipes[i].creator = NULL;
+            release(&pipes[i], false);
+            release(&pipes[i], true);
+        }
+    }
+}
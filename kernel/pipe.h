@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file pipe.h
+/// \brief Declaration of the pipes.
+///
+/// A pipe streams bytes from the tasks which write to it to the tasks which read from
+/// it, through a ring buffer. Each task has an input and an output, the keyboard and the
+/// screen or a pipe, inherited by the tasks it executes or forks: the system calls
+/// reading and printing characters use them.
+///
+/// The tasks aren't preempted: a task writing to a full pipe calls a task waiting to read
+/// from it, or waits itself (see task_block()), and the other way round for an empty
+/// pipe. The data is copied in bulk, so the tasks switch once per buffer. A pipe holds a
+/// reference of its creator to both ends until pipe_close(): its readers don't see the
+/// end of the data while it creates the tasks of a pipeline.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _PIPE_H_
+#define _PIPE_H_
+
+#include "../common/types.h"
+
+#define PIPE_MAX_PIPES  32
+#define PIPE_SIZE       4096    // Buffer of a pipe, a power of two
+
+struct pipe_st;
+struct task_st;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int pipe_create()
+/// \brief Creates a pipe, held by the calling task until it closes it or exits.
+/// \return The number of the pipe, -1 if there is no free pipe, no memory or no calling
+///         task.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int pipe_create();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int pipe_close(uint32_t pipe)
+/// \brief Releases the ends held by the creator of a pipe. The pipe is destroyed once no
+///        task reads from it or writes to it.
+/// \return 0, or -1 if the pipe doesn't exist or wasn't created by the calling task.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int pipe_close(uint32_t pipe);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int pipe_redirect(uint32_t pipe, bool output)
+/// \brief Connects the input or the output of the calling task to a pipe.
+/// \param pipe : Number of the pipe, PIPE_CONSOLE (see syscall_nb.h) for the keyboard or
+///        the screen.
+/// \return 0, or -1 if the pipe doesn't exist or there is no calling task.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int pipe_redirect(uint32_t pipe, bool output);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int pipe_read(struct pipe_st *pipe, void *data, uint32_t size)
+/// \brief Reads the available bytes, up to size, and waits for some if there are none.
+/// \return The number of bytes read, 0 when every writer is gone and the pipe is empty,
+///         -1 if the calling task can't wait.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int pipe_read(struct pipe_st *pipe, void *data, uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int pipe_read_line(struct pipe_st *pipe, char *line, uint32_t size)
+/// \brief Reads a line, without its '\n', like keyboard_read_line().
+/// \return The length of the line, -1 at the end of the data or if the calling task
+///         can't wait.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int pipe_read_line(struct pipe_st *pipe, char *line, uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int pipe_write(struct pipe_st *pipe, const void *data, uint32_t size)
+/// \brief Writes size bytes, waiting while the pipe is full.
+/// \return The number of bytes written, less than size if the readers are gone or if
+///         the calling task can't wait, -1 if nothing could be written.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int pipe_write(struct pipe_st *pipe, const void *data, uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void pipe_task_inherit(struct task_st *task, struct task_st *parent)
+/// \brief Gives a new task the input and the output of the task which created it.
+/// \param parent : NULL when the kernel created the task.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void pipe_task_inherit(struct task_st *task, struct task_st *parent);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void pipe_task_exit(struct task_st *task)
+/// \brief Releases the input, the output and the pipes created by an exiting task.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void pipe_task_exit(struct task_st *task);
+
+#endif
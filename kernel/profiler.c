@@ -0,0 +1,166 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file profiler.c
+/// \brief Implementation of the sampling profiler.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "profiler.h"
+
+#include "gdt.h"
+#include "io.h"
+#include "irq.h"
+#include "paging.h"
+#include "x86.h"
+#include "../common/string.h"
+
+// Maximum distance between two consecutive frame pointers of a kernel stack
+#define KERNEL_FRAME_MAX_GAP 0x10000
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static profiler_sample_t samples[PROFILER_NB_SAMPLES];
+static uint32_t write_index = 0;    // Index of the next sample to write
+static uint32_t nb_samples = 0;     // Number of valid samples (<= PROFILER_NB_SAMPLES)
+static uint32_t nb_overwritten = 0; // Number of samples lost because the ring was full
+static bool running = false;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Walks the EBP chain starting at ebp and fills the frames of the sample.
+// base is the linear address of the segment the frame pointers are relative to and
+// limit the size of that segment (0 for the flat kernel segment).
+static void walk_frames(profiler_sample_t *sample, uint32_t ebp, uint32_t base, uint32_t limit)
+{
+    uint32_t previous = ebp;
+
+    sample->depth = 0;
+    while (sample->depth < PROFILER_MAX_DEPTH && ebp != 0)
+    {
+        // Both the saved EBP and the return address must lie within the segment
+        if (limit != 0 && ebp > limit - 8)
+        {
+            break;
+        }
+
+        // Don't let a corrupted frame pointer commit pages of the task
+        if (!paging_is_present(base + ebp) || !paging_is_present(base + ebp + 4))
+        {
+            break;
+        }
+
+        uint32_t *frame = (uint32_t*)(base + ebp);
+        sample->frames[sample->depth++] = frame[1];
+
+        // Stacks grow downward: callers' frames are always at higher addresses
+        uint32_t next = frame[0];
+        if (next <= ebp || (limit == 0 && next - previous > KERNEL_FRAME_MAX_GAP))
+        {
+            break;
+        }
+        previous = ebp;
+        ebp = next;
+    }
+}
+
+// Shares the timer IRQ, which is raised by the timer alone.
+static bool profiler_handler(regs_t *regs, void *data)
+{
+    (void)data;
+    profiler_sample(regs);
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void profiler_init()
+{
+    irq_register(0, profiler_handler, NULL, "profiler");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void profiler_start()
+{
+    running = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void profiler_stop()
+{
+    running = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void profiler_reset()
+{
+    write_index = nb_samples = nb_overwritten = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void profiler_sample(regs_t *regs)
+{
+    if (!running)
+    {
+        return;
+    }
+
+    profiler_sample_t *sample = &samples[write_index];
+    task_t *task = current_task();
+
+    sample->eip = regs->eip;
+    sample->cs = (uint16_t)regs->cs;
+    if (task == NULL)
+    {
+        sample->task = -1;
+        strncpy(sample->name, "kernel", sizeof(sample->name));
+    }
+    else
+    {
+        sample->task = task_index(task);
+        strncpy(sample->name, task->name, sizeof(sample->name));
+    }
+
+    // User mode addresses are relative to the task's segments
+    if ((regs->cs & 3) == DPL_USER && task != NULL)
+    {
+        walk_frames(sample, regs->ebp, PAGING_USER_BASE, task->memory_size);
+    }
+    else
+    {
+        walk_frames(sample, regs->ebp, 0, 0);
+    }
+
+    write_index = (write_index + 1) % PROFILER_NB_SAMPLES;
+    if (nb_samples < PROFILER_NB_SAMPLES)
+    {
+        nb_samples++;
+    }
+    else
+    {
+        nb_overwritten++;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void profiler_dump()
+{
+    bool was_running = running;
+    running = false;
+
+    printf("# profile samples=%d overwritten=%d\n", nb_samples, nb_overwritten);
+
+    // Oldest sample first
+    uint32_t index = (write_index + PROFILER_NB_SAMPLES - nb_samples) % PROFILER_NB_SAMPLES;
+    for (uint32_t i = 0; i < nb_samples; i++)
+    {
+        profiler_sample_t *sample = &samples[index];
+
+        printf("S %s %d %x %x", sample->name, sample->task, sample->cs, sample->eip);
+        for (uint32_t j = 0; j < sample->depth; j++)
+        {
+            printf(" %x", sample->frames[j]);
+        }
+        printf("\n");
+
+        index = (index + 1) % PROFILER_NB_SAMPLES;
+    }
+
+    running = was_running;
+}
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file profiler.h
+/// \brief Declaration of the sampling profiler functions.
+///
+/// The profiler is driven by the timer interruption: at each tick, the interrupted
+/// instruction pointer, code segment, current task and a short call stack (walked along
+/// the EBP chain) are recorded in a fixed-size ring buffer. The samples are dumped as
+/// text lines that tools/profsym symbolizes on the host.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include "../common/types.h"
+#include "idt.h"
+
+#define PROFILER_NB_SAMPLES 2048
+#define PROFILER_MAX_DEPTH  8
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct profiler_sample_t
+/// \brief One sample of the profiler.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct profiler_sample_st {
+    uint32_t eip;                           ///< Interrupted instruction pointer
+    uint16_t cs;                            ///< Interrupted code segment selector
+    int16_t  task;                          ///< Task index, -1 for the kernel
+    char     name[32];                      ///< Name of the task's executable
+    uint32_t depth;                         ///< Number of valid return addresses
+    uint32_t frames[PROFILER_MAX_DEPTH];    ///< Return addresses, innermost first
+} profiler_sample_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void profiler_init()
+/// \brief Registers the profiler on the timer IRQ, after the timer (see irq.h).
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void profiler_init();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void profiler_start()
+/// \brief Starts recording samples at each timer tick.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void profiler_start();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void profiler_stop()
+/// \brief Stops recording samples. The recorded samples are kept.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void profiler_stop();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void profiler_reset()
+/// \brief Discards all the recorded samples.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void profiler_reset();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void profiler_sample(regs_t *regs)
+/// \brief Records a sample of the interrupted context.
+///
+/// Called at each timer tick. Does nothing if the profiler is stopped.
+/// When the ring buffer is full, the oldest sample is overwritten.
+///
+/// \param regs : CPU context saved by the interruption wrapper.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void profiler_sample(regs_t *regs);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void profiler_dump()
+/// \brief Prints the recorded samples.
+///
+/// The output starts with a "# profile" header line followed by one line per sample :
+///
+///     S <task name> <task index> <cs> <eip> <return address> ...
+///
+/// The task name is "kernel" and its index -1 when no task was running. The selector and
+/// the addresses are hexadecimal.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void profiler_dump();
+
+#endif
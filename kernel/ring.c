@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file ring.c
+/// \brief Implementation of the single-producer single-consumer ring buffer.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ring.h"
+
+#include "../common/string.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void ring_init(ring_t *ring, void *buffer, uint32_t size)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->mask = size - 1;
+    ring->data = buffer;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t ring_write(ring_t *ring, const void *buffer, uint32_t count)
+{
+    uint32_t head = ring->head;
+    uint32_t space = ring->mask + 1 - (head - ring->tail);
+    if (count > space)
+    {
+        count = space;
+    }
+
+    // At most two copies, the second one from the start of the buffer
+    uint32_t index = head & ring->mask;
+    uint32_t first = ring->mask + 1 - index;
+    if (first > count)
+    {
+        first = count;
+    }
+    memcpy(ring->data + index, (void*)buffer, first);
+    memcpy(ring->data, (uint8_t*)buffer + first, count - first);
+
+    barrier();
+    ring->head = head + count;
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t ring_peek(const ring_t *ring, void *buffer, uint32_t count)
+{
+    uint32_t tail = ring->tail;
+    uint32_t available = ring->head - tail;
+    if (count > available)
+    {
+        count = available;
+    }
+    barrier();
+
+    uint32_t index = tail & ring->mask;
+    uint32_t first = ring->mask + 1 - index;
+    if (first > count)
+    {
+        first = count;
+    }
+    memcpy(buffer, ring->data + index, first);
+    memcpy((uint8_t*)buffer + first, ring->data, count - first);
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void ring_skip(ring_t *ring, uint32_t count)
+{
+    barrier();
+    ring->tail += count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t ring_read(ring_t *ring, void *buffer, uint32_t count)
+{
+    count = ring_peek(ring, buffer, count);
+    ring_skip(ring, count);
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void ring_clear(ring_t *ring)
+{
+    ring->tail = ring->head;
+}
@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file ring.h
+/// \brief Declaration of the single-producer single-consumer ring buffer.
+///
+/// The ring passes bytes from one producer to one consumer without lock, typically from
+/// an interruption routine to a task or the other way round. head and tail count the
+/// bytes ever written and read: they only increase, wrap around freely and are masked
+/// to index the buffer, whose size is a power of two. Only the producer changes head and
+/// only the consumer changes tail, after the data is copied.
+///
+/// Several producers (or consumers) must be serialized by the caller, for example by
+/// disabling the interruptions.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _RING_H_
+#define _RING_H_
+
+#include "../common/types.h"
+#include "x86.h"
+
+typedef struct ring_st {
+    volatile uint32_t head;     // Bytes written, changed by the producer
+    volatile uint32_t tail;     // Bytes read, changed by the consumer
+    uint32_t mask;              // Size of the buffer - 1
+    uint8_t *data;
+} ring_t;
+
+// Static initializer of an empty ring using an array whose size is a power of two
+#define RING_INIT(array) { 0, 0, sizeof(array) - 1, (uint8_t*)(array) }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void ring_init(ring_t *ring, void *buffer, uint32_t size)
+/// \brief Initializes an empty ring.
+/// \param buffer : Storage of the ring.
+/// \param size : Size of the buffer, a power of two.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void ring_init(ring_t *ring, void *buffer, uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t ring_count(const ring_t *ring)
+/// \brief Returns the number of bytes which can be read.
+//////////////////////////////////////////////////////////////////////////////////////////
+static inline uint32_t ring_count(const ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t ring_space(const ring_t *ring)
+/// \brief Returns the number of bytes which can be written.
+//////////////////////////////////////////////////////////////////////////////////////////
+static inline uint32_t ring_space(const ring_t *ring)
+{
+    return ring->mask + 1 - (ring->head - ring->tail);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool ring_empty(const ring_t *ring)
+/// \brief Returns true if there is nothing to read.
+//////////////////////////////////////////////////////////////////////////////////////////
+static inline bool ring_empty(const ring_t *ring)
+{
+    return ring->head == ring->tail;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool ring_put(ring_t *ring, uint8_t byte)
+/// \brief Writes a byte, producer side.
+/// \return false if the ring is full, the byte is dropped.
+//////////////////////////////////////////////////////////////////////////////////////////
+static inline bool ring_put(ring_t *ring, uint8_t byte)
+{
+    uint32_t head = ring->head;
+    if (head - ring->tail > ring->mask)
+    {
+        return false;
+    }
+    ring->data[head & ring->mask] = byte;
+    barrier();      // The byte is stored before it is published
+    ring->head = head + 1;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool ring_get(ring_t *ring, uint8_t *byte)
+/// \brief Reads a byte, consumer side.
+/// \return false if the ring is empty.
+//////////////////////////////////////////////////////////////////////////////////////////
+static inline bool ring_get(ring_t *ring, uint8_t *byte)
+{
+    uint32_t tail = ring->tail;
+    if (ring->head == tail)
+    {
+        return false;
+    }
+    barrier();      // head is loaded before the byte
+    *byte = ring->data[tail & ring->mask];
+    barrier();      // The byte is loaded before its place is given back
+    ring->tail = tail + 1;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t ring_write(ring_t *ring, const void *buffer, uint32_t count)
+/// \brief Writes as many bytes as possible, up to count, producer side.
+/// \return The number of bytes written.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t ring_write(ring_t *ring, const void *buffer, uint32_t count);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t ring_read(ring_t *ring, void *buffer, uint32_t count)
+/// \brief Reads the available bytes, up to count, consumer side.
+/// \return The number of bytes read.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t ring_read(ring_t *ring, void *buffer, uint32_t count);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t ring_peek(const ring_t *ring, void *buffer, uint32_t count)
+/// \brief Copies the available bytes, up to count, without reading them, consumer side.
+/// \return The number of bytes copied.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t ring_peek(const ring_t *ring, void *buffer, uint32_t count);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void ring_skip(ring_t *ring, uint32_t count)
+/// \brief Reads count bytes already copied by ring_peek(), consumer side.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void ring_skip(ring_t *ring, uint32_t count);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void ring_clear(ring_t *ring)
+/// \brief Drops the available bytes, consumer side.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void ring_clear(ring_t *ring);
+
+#endif
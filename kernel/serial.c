@@ -0,0 +1,235 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file serial.c
+/// \brief Implementation of the serial port (COM1) functions.
+///
+/// Reference: http://wiki.osdev.org/Serial_Ports
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "serial.h"
+
+#include "irq.h"
+#include "keyboard.h"
+#include "periph.h"
+#include "ring.h"
+#include "x86.h"
+#include "../common/common_io.h"
+
+#define SERIAL_DATA         (COM1_PORT + 0)
+#define SERIAL_IER          (COM1_PORT + 1)   // Interrupt enable register
+#define SERIAL_IIR          (COM1_PORT + 2)   // Interrupt identification register (read)
+#define SERIAL_FCR          (COM1_PORT + 2)   // FIFO control register (write)
+#define SERIAL_LCR          (COM1_PORT + 3)   // Line control register
+#define SERIAL_MCR          (COM1_PORT + 4)   // Modem control register
+#define SERIAL_LSR          (COM1_PORT + 5)   // Line status register
+#define SERIAL_MSR          (COM1_PORT + 6)   // Modem status register
+
+#define IER_RX_AVAILABLE    0x01
+#define IER_TX_EMPTY        0x02
+
+#define IIR_NO_INTERRUPT    0x01
+#define IIR_ID_MASK         0x0E
+#define IIR_MODEM_STATUS    0x00
+#define IIR_TX_EMPTY        0x02
+#define IIR_RX_AVAILABLE    0x04
+#define IIR_LINE_STATUS     0x06
+#define IIR_RX_TIMEOUT      0x0C
+
+#define LSR_DATA_READY      0x01
+#define LSR_THR_EMPTY       0x20
+#define LSR_TX_IDLE         0x40
+
+#define MCR_OUT2            0x08    // Must be set for the UART to raise interrupts
+
+#define FIFO_SIZE           16
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+// The tasks and the interruption routines write to the ring, the interruption routine
+// of the UART reads it: both sides run with the interruptions disabled (see ring.h)
+static uint8_t tx_buffer[SERIAL_TX_BUFFER_SIZE];
+static ring_t tx_ring = RING_INIT(tx_buffer);
+static bool tx_interrupt_enabled = false;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Moves up to a FIFO's worth of characters from the ring buffer to the UART. Must be
+// called with interruptions disabled, when the transmitter holding register is empty.
+static void fill_fifo()
+{
+    uint8_t fifo[FIFO_SIZE];
+    uint32_t count = ring_read(&tx_ring, fifo, FIFO_SIZE);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        outb(SERIAL_DATA, fifo[i]);
+    }
+
+    // The "transmitter empty" interruption is only needed while there is data to send
+    bool enable = !ring_empty(&tx_ring);
+    if (enable != tx_interrupt_enabled)
+    {
+        tx_interrupt_enabled = enable;
+        outb(SERIAL_IER, IER_RX_AVAILABLE | (enable ? IER_TX_EMPTY : 0));
+    }
+}
+
+// Queues characters without any translation.
+static void queue_chars(const char *characters, uint32_t count)
+{
+    uint32_t flags = irq_save();
+
+    while (count > 0)
+    {
+        uint32_t written = ring_write(&tx_ring, characters, count);
+        characters += written;
+        count -= written;
+
+        // Sends the oldest characters synchronously to make some room
+        if (count > 0)
+        {
+            while ((inb(SERIAL_LSR) & LSR_THR_EMPTY) == 0);
+            fill_fifo();
+        }
+    }
+
+    // Starts the transmission if the UART is idle, the interruption does the rest
+    if (!tx_interrupt_enabled && (inb(SERIAL_LSR) & LSR_THR_EMPTY))
+    {
+        fill_fifo();
+    }
+
+    irq_restore(flags);
+}
+
+// Serial port interruption routine. Refills the transmission FIFO from the ring buffer
+// and moves the received characters into the keyboard buffer.
+static bool serial_handler(regs_t *regs, void *data)
+{
+    (void)regs;
+    (void)data;
+    uint8_t iir;
+    bool handled = false;
+
+    // Several sources can be pending, handles them until the UART has nothing left
+    while (((iir = inb(SERIAL_IIR)) & IIR_NO_INTERRUPT) == 0)
+    {
+        handled = true;
+        switch (iir & IIR_ID_MASK)
+        {
+        case IIR_RX_AVAILABLE:
+        case IIR_RX_TIMEOUT:
+            while (inb(SERIAL_LSR) & LSR_DATA_READY)
+            {
+                char c = (char)inb(SERIAL_DATA);
+
+                // Terminals send CR for the return key and DEL for backspace
+                if (c == '\r')
+                {
+                    c = '\n';
+                }
+                else if (c == 0x7F)
+                {
+                    c = '\b';
+                }
+                keyboard_put_char(c);
+            }
+            break;
+
+        case IIR_TX_EMPTY:
+            fill_fifo();
+            break;
+
+        case IIR_LINE_STATUS:
+            inb(SERIAL_LSR);
+            break;
+
+        case IIR_MODEM_STATUS:
+            inb(SERIAL_MSR);
+            break;
+
+        default:
+            break;
+        }
+    }
+    return handled;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void serial_init()
+{
+    outb(SERIAL_IER, 0x00);     // Disable all interrupts
+    outb(SERIAL_LCR, 0x80);     // Enable DLAB to set the baud rate divisor
+    outb(SERIAL_DATA, 0x01);    // Divisor 1 (low byte) : 115200 bauds
+    outb(SERIAL_IER, 0x00);     //           (high byte)
+    outb(SERIAL_LCR, 0x03);     // 8 bits, no parity, one stop bit
+    outb(SERIAL_FCR, 0xC7);     // Enable and clear the FIFOs, 14-byte threshold
+    outb(SERIAL_MCR, 0x03 | MCR_OUT2);  // DTR, RTS and IRQ line enabled
+
+    ring_init(&tx_ring, tx_buffer, SERIAL_TX_BUFFER_SIZE);
+    tx_interrupt_enabled = false;
+    irq_register(4, serial_handler, NULL, "serial");
+    outb(SERIAL_IER, IER_RX_AVAILABLE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void serial_put_char(char c)
+{
+    switch (c)
+    {
+    case '\n':
+        queue_chars("\r\n", 2);
+        break;
+
+    case '\b':  // Erases the previous character on the terminal
+        queue_chars("\b \b", 3);
+        break;
+
+    default:
+        queue_chars(&c, 1);
+        break;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void serial_print_str(char *str)
+{
+    // The characters between two translated ones are queued at once
+    while (*str != '\0')
+    {
+        uint32_t length = 0;
+        while (str[length] != '\0' && str[length] != '\n' && str[length] != '\b')
+        {
+            length++;
+        }
+        if (length > 0)
+        {
+            queue_chars(str, length);
+            str += length;
+        }
+        else
+        {
+            serial_put_char(*str);
+            str++;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void serial_printf(char *frmt, ...)
+{
+    __genericPrintFormat(serial_put_char, serial_print_str, &frmt);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void serial_flush()
+{
+    uint32_t flags = irq_save();
+
+    while (!ring_empty(&tx_ring))
+    {
+        while ((inb(SERIAL_LSR) & LSR_THR_EMPTY) == 0);
+        fill_fifo();
+    }
+    while ((inb(SERIAL_LSR) & LSR_TX_IDLE) == 0);
+
+    irq_restore(flags);
+}
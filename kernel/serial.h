@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file serial.h
+/// \brief Declaration of the serial port (COM1) functions.
+///
+/// The driver uses the FIFOs of the 16550 UART and its interruption (IRQ 4) : sent
+/// characters are queued in a ring buffer that the interruption routine drains, and
+/// received characters are put in the keyboard buffer.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SERIAL_H_
+#define _SERIAL_H_
+
+#include "../common/types.h"
+
+#define COM1_PORT               0x3F8
+#define SERIAL_TX_BUFFER_SIZE   4096    // Power of two (see ring.h)
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void serial_init()
+/// \brief Initializes COM1 at 115200 bauds, 8 data bits, no parity, 1 stop bit.
+///
+/// Enables the FIFOs and the reception interruption, whose routine is registered on
+/// IRQ 4.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void serial_init();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void serial_put_char(char c)
+/// \brief Queues a character to be sent on the serial port.
+///
+/// Doesn't wait for the character to be sent. Only if the ring buffer is full, the
+/// oldest queued characters are sent by polling the UART to make some room. A line feed
+/// is preceded by a carriage return.
+///
+/// \param c : The character to be sent.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void serial_put_char(char c);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void serial_print_str(char *str)
+/// \brief Queues a string to be sent on the serial port.
+/// \param str : The string to be sent.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void serial_print_str(char *str);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void serial_printf(char *frmt, ...)
+/// \brief Queues a formated string to be sent on the serial port.
+///
+/// Supports the same format codes as printf.
+///
+/// \param frmt : The format string.
+/// \param ... : Values to be inserted into the string.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void serial_printf(char *frmt, ...);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void serial_flush()
+/// \brief Waits until all the queued characters have been sent.
+///
+/// Works with interruptions disabled, by polling the UART.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void serial_flush();
+
+#endif
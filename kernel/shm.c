@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file shm.c
+/// \brief Implementation of the shared memory regions.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "shm.h"
+
+#include "frame.h"
+#include "gdt.h"
+#include "kmalloc.h"
+#include "paging.h"
+#include "../common/string.h"
+
+typedef struct region_st {
+    task_t *creator;            // NULL for a free region
+    uint32_t nb_pages;
+    uint32_t *frames;           // One reference to each frame, besides the mappings
+} region_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static region_t regions[SHM_MAX_REGIONS];
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Drops the references of a region to its first nb_frames frames and frees it.
+static void destroy_region(region_t *region, uint32_t nb_frames)
+{
+    for (uint32_t i = 0; i < nb_frames; i++)
+    {
+        frame_free(region->frames[i]);
+    }
+    kfree(region->frames);
+    region->frames = NULL;
+    region->creator = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int shm_create(uint32_t size)
+{
+    task_t *task = current_task();
+    uint32_t nb_pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (task == NULL || nb_pages == 0 || nb_pages > SHM_MAX_PAGES)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < SHM_MAX_REGIONS; i++)
+    {
+        region_t *region = &regions[i];
+        if (region->creator != NULL)
+        {
+            continue;
+        }
+
+        region->frames = kmalloc(nb_pages * sizeof(uint32_t));
+        if (region->frames == NULL)
+        {
+            return -1;
+        }
+        region->creator = task;
+        region->nb_pages = nb_pages;
+
+        for (uint32_t j = 0; j < nb_pages; j++)
+        {
+            region->frames[j] = frame_alloc();
+            if (region->frames[j] == 0)
+            {
+                destroy_region(region, j);
+                return -1;
+            }
+            memset((void*)region->frames[j], 0, PAGE_SIZE);
+        }
+        return i;
+    }
+    return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int shm_map(uint32_t region, uint32_t address)
+{
+    task_t *task = current_task();
+    region_t *r = region < SHM_MAX_REGIONS && regions[region].creator != NULL ? &regions[region] : NULL;
+    if (task == NULL || r == NULL)
+    {
+        return -1;
+    }
+
+    uint32_t size = r->nb_pages * PAGE_SIZE;
+    uint32_t image_end = task->image != NULL ? (task->image->size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1) : 0;
+    if ((address & (PAGE_SIZE - 1)) != 0 || address < image_end || address > task->memory_size
+        || size > task->memory_size - address)
+    {
+        return -1;
+    }
+
+    return paging_map_shared(PAGING_USER_BASE + address, r->frames, r->nb_pages) ? (int)size : -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void shm_task_exit(task_t *task)
+{
+    for (int i = 0; i < SHM_MAX_REGIONS; i++)
+    {
+        if (regions[i].creator == task)
+        {
+            destroy_region(&regions[i], regions[i].nb_pages);
+        }
+    }
+}
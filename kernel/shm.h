@@ -0,0 +1,53 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file shm.h
+/// \brief Declaration of the shared memory regions.
+///
+/// A region is a set of frames which the tasks map in their memory window, at the
+/// address of their choice: the tasks read and write the same physical memory, without
+/// any copy by the kernel. Each mapping owns a reference to the frames (see
+/// frame_share()), so the pages stay mapped when the region is destroyed, with its
+/// creator, and are freed by the last task unmapping them. The tasks forked by a task
+/// share its mappings too.
+///
+/// The kernel doesn't synchronize the accesses: the tasks signal each other through a
+/// port or a pipe.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SHM_H_
+#define _SHM_H_
+
+#include "../common/types.h"
+
+#define SHM_MAX_REGIONS 32
+#define SHM_MAX_PAGES   1024    // 4 MB per region
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int shm_create(uint32_t size)
+/// \brief Creates a zeroed region, destroyed when the calling task exits.
+/// \param size : Size of the region in bytes, rounded up to pages.
+/// \return The number of the region, -1 if the size is invalid, if there is no free
+///         region, no memory or no calling task.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int shm_create(uint32_t size);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int shm_map(uint32_t region, uint32_t address)
+/// \brief Maps a region in the memory of the calling task.
+///
+/// The pages which were at the address are freed. The region must be outside of the
+/// executable, whose pages belong to the image cache.
+///
+/// \param address : Page aligned address in the task memory.
+/// \return The size of the region in bytes, -1 if the region doesn't exist, if the
+///         address is invalid or if a page table can't be allocated.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int shm_map(uint32_t region, uint32_t address);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void shm_task_exit(struct task_st *task)
+/// \brief Destroys the regions of an exiting task. The tasks mapping them keep the pages.
+//////////////////////////////////////////////////////////////////////////////////////////
+struct task_st;
+extern void shm_task_exit(struct task_st *task);
+
+#endif
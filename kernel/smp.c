@@ -0,0 +1,205 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file smp.c
+/// \brief Implementation of the multiprocessor functions.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "smp.h"
+
+#include "apic.h"
+#include "frame.h"
+#include "gdt.h"
+#include "idt.h"
+#include "io.h"
+#include "paging.h"
+#include "timer.h"
+#include "x86.h"
+#include "../common/string.h"
+
+// Startup delays of the INIT-SIPI-SIPI sequence [us]
+#define INIT_DELAY              10000
+#define STARTUP_DELAY           200
+#define STARTED_TIMEOUT         100000
+
+// Address of a variable of the trampoline once copied (see smp_asm.s)
+#define TRAMPOLINE_VARIABLE(name) \
+    ((uint32_t*)(SMP_TRAMPOLINE_BASE + ((uint8_t*)name - smp_trampoline)))
+
+// Implemented in smp_asm.s
+extern uint8_t smp_trampoline[];
+extern uint8_t smp_trampoline_cr3[];
+extern uint8_t smp_trampoline_stack[];
+extern uint8_t smp_trampoline_end[];
+
+typedef struct cpu_st {
+    uint32_t apic_id;
+    volatile bool started;
+} cpu_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static cpu_t cpus[MAX_NB_CPUS];
+static volatile uint32_t nb_cpus = 1;
+
+static volatile uint32_t booting_cpu;   // Index given to the AP being started
+
+// Function of smp_run_on_all(), run by the APs when the generation changes
+static smp_function_t call_function;
+static void *call_arg;
+static volatile uint32_t call_generation = 0;
+static volatile uint32_t nb_calls_done;     // APs done with the current function
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Busy waits during us microseconds.
+static void delay_us(uint32_t us)
+{
+    uint32_t cycles = get_tsc_khz() / 1000 * us;
+    uint32_t start = (uint32_t)rdtsc();
+    while ((uint32_t)rdtsc() - start < cycles)
+    {
+        cpu_relax();
+    }
+}
+
+// Starts the processor of a local APIC as processor nb_cpus. It is dropped if it doesn't
+// start in time.
+static void start_processor(uint32_t apic_id)
+{
+    uint32_t stack = frame_alloc_order(TASKS_KERNEL_STACK_ORDER);
+    if (stack == 0)
+    {
+        return;
+    }
+
+    uint32_t cpu = nb_cpus;
+    cpus[cpu].apic_id = apic_id;
+    booting_cpu = cpu;
+    *TRAMPOLINE_VARIABLE(smp_trampoline_stack) = stack + TASKS_KERNEL_STACK_SIZE;
+
+    lapic_send_ipi(apic_id, LAPIC_ICR_INIT);
+    delay_us(INIT_DELAY);
+    for (int i = 0; i < 2 && !cpus[cpu].started; i++)
+    {
+        lapic_send_ipi(apic_id, LAPIC_ICR_STARTUP | (SMP_TRAMPOLINE_BASE / PAGE_SIZE));
+        delay_us(STARTUP_DELAY);
+    }
+    for (uint32_t waited = 0; waited < STARTED_TIMEOUT && !cpus[cpu].started; waited += 100)
+    {
+        delay_us(100);
+    }
+
+    if (!cpus[cpu].started)
+    {
+        printf("smp: processor %u (APIC %u) didn't start\n", cpu, apic_id);
+        frame_free(stack);
+        return;
+    }
+    nb_cpus++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void ap_main()
+/// \brief Entry point of the application processors, called by the trampoline.
+//////////////////////////////////////////////////////////////////////////////////////////
+void ap_main()
+{
+    uint32_t cpu = booting_cpu;
+    uint32_t stack = *TRAMPOLINE_VARIABLE(smp_trampoline_stack);
+
+    gdt_init_cpu(cpu, stack);
+    idt_init_cpu();
+    lapic_enable();
+    cpus[cpu].started = true;
+
+    // Only the local APIC timer interrupts the processor, which polls for a function to
+    // run, see smp_run_on_all()
+    apic_timer_init();
+    sti();
+    uint32_t generation = 0;
+    while (1)
+    {
+        if (call_generation != generation)
+        {
+            generation = call_generation;
+            barrier();
+            call_function(call_arg);
+            atomic_add(&nb_calls_done, 1);
+        }
+        cpu_relax();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void smp_init()
+{
+    cpus[0].apic_id = lapic_id();
+    cpus[0].started = true;
+    if (apic_nb_processors() == 0)
+    {
+        return;
+    }
+
+    memcpy((void*)SMP_TRAMPOLINE_BASE, smp_trampoline, smp_trampoline_end - smp_trampoline);
+    *TRAMPOLINE_VARIABLE(smp_trampoline_cr3) = paging_kernel_directory();
+
+    // The processors are started one at a time, they share the trampoline
+    for (uint32_t i = 0; i < apic_nb_processors(); i++)
+    {
+        if (apic_processor(i) != cpus[0].apic_id && nb_cpus < MAX_NB_CPUS)
+        {
+            start_processor(apic_processor(i));
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t smp_nb_cpus()
+{
+    return nb_cpus;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t smp_cpu_id()
+{
+    if (nb_cpus == 1)
+    {
+        return 0;
+    }
+
+    // A starting processor has no index yet, but is marked started
+    uint32_t apic_id = lapic_id();
+    for (uint32_t i = 0; i < MAX_NB_CPUS; i++)
+    {
+        if (cpus[i].started && cpus[i].apic_id == apic_id)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void smp_run_on_all(smp_function_t function, void *arg)
+{
+    call_function = function;
+    call_arg = arg;
+    nb_calls_done = 0;
+    barrier();      // The function is set before the APs see the new generation
+    call_generation = call_generation + 1;
+
+    function(arg);
+    while (nb_calls_done != nb_cpus - 1)
+    {
+        cpu_relax();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void smp_dump_stats()
+{
+    printf("cpu\tapic\tticks\n");
+    for (uint32_t i = 0; i < nb_cpus; i++)
+    {
+        printf("%u\t%u\t%u\n", i, cpus[i].apic_id, apic_timer_ticks(i));
+    }
+}
@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file smp.h
+/// \brief Declaration of the multiprocessor functions.
+///
+/// The processors are listed by the ACPI MADT table, or by the MP tables of older
+/// BIOSes (see apic.h), and the application processors (APs) are started with the
+/// INIT-SIPI-SIPI sequence of their local APIC. Each processor has its own TSS, kernel
+/// stack and local APIC timer.
+///
+/// The tasks still run on the bootstrap processor only: they are called synchronously
+/// and most of the kernel they call isn't protected by locks. The other processors idle
+/// until smp_run_on_all() gives them a function to run, which the benchmarks use to
+/// measure the locks under contention. Per-CPU run queues for the tasks and their
+/// scaling with the processors are left to a later change.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SMP_H_
+#define _SMP_H_
+
+#include "../common/types.h"
+
+#define MAX_NB_CPUS             8
+#define SMP_TRAMPOLINE_BASE     0x8000      // Startup code of the APs, must match const.inc
+
+// A kernel function run by every processor
+typedef void (*smp_function_t)(void *arg);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void smp_init()
+/// \brief Lists the processors and starts the application processors.
+///
+/// Without ACPI or MP tables, the kernel runs on the bootstrap processor alone. The
+/// startup delays are measured with the time-stamp counter: interruptions must be
+/// enabled (see get_tsc_khz()).
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void smp_init();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t smp_nb_cpus()
+/// \brief Returns the number of running processors, the bootstrap processor included.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t smp_nb_cpus();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t smp_cpu_id()
+/// \brief Returns the index of the calling processor, 0 for the bootstrap processor.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t smp_cpu_id();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void smp_run_on_all(smp_function_t function, void *arg)
+/// \brief Runs a function on every processor at the same time and waits until every
+///        call is over.
+///
+/// Only called by the bootstrap processor, which runs the function too. The APs are
+/// only interrupted by their local APIC timer, the bootstrap processor also handles the
+/// IRQs.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void smp_run_on_all(smp_function_t function, void *arg);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void smp_dump_stats()
+/// \brief Prints the APIC identifier and the timer ticks of each processor.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void smp_dump_stats();
+
+#endif
@@ -0,0 +1,74 @@
+%include "const.inc"
+
+extern ap_main
+
+global smp_trampoline
+global smp_trampoline_cr3
+global smp_trampoline_stack
+global smp_trampoline_end
+
+; Position of a label of the trampoline once copied at SMP_TRAMPOLINE_BASE
+%define RELOC(label) (SMP_TRAMPOLINE_BASE + ((label) - smp_trampoline))
+
+section .text                      ; start of the text (code) section
+align 4                            ; the code must be 4 byte aligned
+
+; Startup code of the application processors, copied at SMP_TRAMPOLINE_BASE by smp.c.
+; The startup IPI makes the processor execute it in real mode: it switches to protected
+; mode with a flat GDT, enables paging with the kernel page directory, loads the stack
+; given by smp.c and calls ap_main(), which never returns.
+bits 16
+smp_trampoline:
+    cli
+    xor     ax,ax
+    mov     ds,ax
+    o32 lgdt [RELOC(trampoline_gdt_ptr)]
+    mov     eax,cr0
+    or      eax,1                  ; protection enable
+    mov     cr0,eax
+    jmp     dword GDT_KERNEL_CODE_SELECTOR:RELOC(trampoline_protected)
+
+bits 32
+trampoline_protected:
+    mov     ax,GDT_KERNEL_DATA_SELECTOR
+    mov     ds,ax
+    mov     es,ax
+    mov     fs,ax
+    mov     gs,ax
+    mov     ss,ax
+
+    ; Same paging as the bootstrap processor (see paging_init)
+    mov     eax,cr4
+    or      eax,0x10               ; 4 MB pages
+    mov     cr4,eax
+    mov     eax,[RELOC(smp_trampoline_cr3)]
+    mov     cr3,eax
+    mov     eax,cr0
+    or      eax,0x80010000         ; paging and write protect
+    mov     cr0,eax
+
+    mov     esp,[RELOC(smp_trampoline_stack)]
+    mov     eax,ap_main            ; absolute address, the kernel is identity mapped
+    call    eax
+.halt:
+    cli
+    hlt
+    jmp     .halt
+
+; Flat code and data segments, with the selectors of the kernel GDT
+align 8
+trampoline_gdt:
+    dq      0
+    dq      0x00CF9A000000FFFF     ; code, base 0, limit 4 GB
+    dq      0x00CF92000000FFFF     ; data, base 0, limit 4 GB
+trampoline_gdt_ptr:
+    dw      trampoline_gdt_ptr - trampoline_gdt - 1
+    dd      RELOC(trampoline_gdt)
+
+; Written by smp.c before each startup IPI
+align 4
+smp_trampoline_cr3:
+    dd      0
+smp_trampoline_stack:
+    dd      0
+smp_trampoline_end:
@@ -0,0 +1,336 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file sync.c
+/// \brief Implementation of the kernel synchronization primitives.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "sync.h"
+
+#include "gdt.h"
+#include "io.h"
+#include "../common/string.h"
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static spinlock_t registry_lock;        // Protects the lists, not listed itself
+static spinlock_t *locks = NULL;
+static wait_queue_t *wait_queues = NULL;
+static spinlock_t wait_lock;            // Protects the wait queues and the woken list
+static wait_queue_t woken;              // Tasks woken and not resumed yet, not listed
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Waits for the turn of the caller. Returns the cycles spent waiting, 0 if the lock was
+// free.
+static uint32_t ticket_lock(spinlock_t *lock)
+{
+    uint32_t ticket = atomic_add(&lock->next, 1);
+    if (lock->owner == ticket)
+    {
+        return 0;
+    }
+
+    uint32_t start = (uint32_t)rdtsc();
+    while (lock->owner != ticket)
+    {
+        cpu_relax();
+    }
+    uint32_t cycles = (uint32_t)rdtsc() - start;
+    return cycles != 0 ? cycles : 1;
+}
+
+// Gives the lock to the next ticket. Only the holder writes owner, the stores before it
+// are seen before it by the other processors.
+static inline void ticket_unlock(spinlock_t *lock)
+{
+    asm volatile("" : : : "memory");
+    lock->owner = lock->owner + 1;
+}
+
+static void clear_lock_stats(spinlock_t *lock)
+{
+    lock->nb_acquired = 0;
+    lock->nb_contended = 0;
+    lock->spin_cycles = 0;
+    lock->hold_cycles = 0;
+    lock->max_hold_cycles = 0;
+}
+
+// Appends a task to a wait queue, wait_lock held.
+static void enqueue(wait_queue_t *queue, task_t *task)
+{
+    task->wait_queue = queue;
+    task->wait_next = NULL;
+    if (queue->last != NULL)
+    {
+        queue->last->wait_next = task;
+    }
+    else
+    {
+        queue->first = task;
+    }
+    queue->last = task;
+}
+
+// Removes a task from its wait queue or from the woken list, if it is in one, wait_lock
+// held.
+static void dequeue(task_t *task)
+{
+    wait_queue_t *queue = task->wait_queue;
+    if (queue == NULL)
+    {
+        return;
+    }
+
+    task_t *previous = NULL;
+    for (task_t *other = queue->first; other != task; other = other->wait_next)
+    {
+        previous = other;
+    }
+    if (previous != NULL)
+    {
+        previous->wait_next = task->wait_next;
+    }
+    else
+    {
+        queue->first = task->wait_next;
+    }
+    if (queue->last == task)
+    {
+        queue->last = previous;
+    }
+    task->wait_queue = NULL;
+    task->wait_next = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void spinlock_init(spinlock_t *lock, const char *name)
+{
+    memset(lock, 0, sizeof(spinlock_t));
+    lock->name = name;
+
+    uint32_t flags = irq_save();
+    ticket_lock(&registry_lock);
+    lock->next_lock = locks;
+    locks = lock;
+    ticket_unlock(&registry_lock);
+    irq_restore(flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void spin_lock(spinlock_t *lock)
+{
+    uint32_t spin_cycles = ticket_lock(lock);
+
+    // The statistics are only changed by the holder
+    lock->nb_acquired++;
+    if (spin_cycles != 0)
+    {
+        lock->nb_contended++;
+        lock->spin_cycles += spin_cycles;
+    }
+    lock->acquired_at = (uint32_t)rdtsc();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void spin_unlock(spinlock_t *lock)
+{
+    uint32_t hold_cycles = (uint32_t)rdtsc() - lock->acquired_at;
+    lock->hold_cycles += hold_cycles;
+    if (hold_cycles > lock->max_hold_cycles)
+    {
+        lock->max_hold_cycles = hold_cycles;
+    }
+    ticket_unlock(lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t spin_lock_irqsave(spinlock_t *lock)
+{
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
+{
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void seqlock_init(seqlock_t *seqlock, const char *name)
+{
+    seqlock->sequence = 0;
+    spinlock_init(&seqlock->lock, name);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t write_seqlock_irqsave(seqlock_t *seqlock)
+{
+    uint32_t flags = spin_lock_irqsave(&seqlock->lock);
+    seqlock->sequence++;
+    asm volatile("" : : : "memory");
+    return flags;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void write_sequnlock_irqrestore(seqlock_t *seqlock, uint32_t flags)
+{
+    asm volatile("" : : : "memory");
+    seqlock->sequence++;
+    spin_unlock_irqrestore(&seqlock->lock, flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void wait_queue_init(wait_queue_t *queue, const char *name)
+{
+    memset(queue, 0, sizeof(wait_queue_t));
+    queue->name = name;
+
+    uint32_t flags = irq_save();
+    ticket_lock(&registry_lock);
+    queue->next_queue = wait_queues;
+    wait_queues = queue;
+    ticket_unlock(&registry_lock);
+    irq_restore(flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void wait_queue_sleep(wait_queue_t *queue)
+{
+    task_t *task = current_task();
+    bool blocked = false;
+    if (task != NULL)
+    {
+        spin_lock(&wait_lock);
+        enqueue(queue, task);
+        spin_unlock(&wait_lock);
+        blocked = task_block();
+    }
+
+    // Still queued if it couldn't block or if a task called it before wake_up()
+    spin_lock(&wait_lock);
+    if (task != NULL)
+    {
+        dequeue(task);
+    }
+    if (blocked)
+    {
+        queue->nb_waits++;
+    }
+    else
+    {
+        queue->nb_halts++;
+    }
+    spin_unlock(&wait_lock);
+
+    if (!blocked)
+    {
+        wait_queue_idle();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void wake_up(wait_queue_t *queue)
+{
+    uint32_t flags = spin_lock_irqsave(&wait_lock);
+    while (queue->first != NULL)
+    {
+        task_t *task = queue->first;
+        dequeue(task);
+        enqueue(&woken, task);
+        queue->nb_wakeups++;
+    }
+    spin_unlock_irqrestore(&wait_lock, flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void wait_queue_idle()
+{
+    if (woken.first == NULL)
+    {
+        sti_hlt_cli();
+    }
+
+    // One at a time: a resumed task may wake others, or resume some itself
+    while (true)
+    {
+        spin_lock(&wait_lock);
+        task_t *task = woken.first;
+        if (task != NULL)
+        {
+            dequeue(task);
+        }
+        spin_unlock(&wait_lock);
+
+        if (task == NULL)
+        {
+            break;
+        }
+        if (task->blocked)
+        {
+            task_resume(task);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void wait_queue_task_exit(task_t *task)
+{
+    uint32_t flags = spin_lock_irqsave(&wait_lock);
+    dequeue(task);
+    spin_unlock_irqrestore(&wait_lock, flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void sync_reset_stats()
+{
+    uint32_t flags = irq_save();
+    ticket_lock(&registry_lock);
+    for (spinlock_t *lock = locks; lock != NULL; lock = lock->next_lock)
+    {
+        // Held, so that the holder doesn't update the statistics meanwhile
+        ticket_lock(lock);
+        clear_lock_stats(lock);
+        ticket_unlock(lock);
+    }
+    for (wait_queue_t *queue = wait_queues; queue != NULL; queue = queue->next_queue)
+    {
+        queue->nb_waits = 0;
+        queue->nb_halts = 0;
+        queue->nb_wakeups = 0;
+    }
+    ticket_unlock(&registry_lock);
+    irq_restore(flags);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void sync_dump_stats()
+{
+    uint32_t flags = irq_save();
+    ticket_lock(&registry_lock);
+
+    printf("lock\tacquired\tcontended\tspin\thold\tmax hold\n");
+    for (spinlock_t *lock = locks; lock != NULL; lock = lock->next_lock)
+    {
+        ticket_lock(lock);
+        spinlock_t copy = *lock;
+        ticket_unlock(lock);
+
+        printf("%s\t%u\t%u\t%u\t%u\t%u\n", copy.name, copy.nb_acquired, copy.nb_contended,
+               copy.nb_contended != 0 ? div64(copy.spin_cycles, copy.nb_contended) : 0,
+               copy.nb_acquired != 0 ? div64(copy.hold_cycles, copy.nb_acquired) : 0,
+               copy.max_hold_cycles);
+    }
+
+    printf("wait queue\twaits\thalts\twakeups\n");
+    for (wait_queue_t *queue = wait_queues; queue != NULL; queue = queue->next_queue)
+    {
+        printf("%s\t%u\t%u\t%u\n", queue->name, queue->nb_waits, queue->nb_halts,
+               queue->nb_wakeups);
+    }
+
+    ticket_unlock(&registry_lock);
+    irq_restore(flags);
+}
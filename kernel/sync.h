@@ -0,0 +1,219 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file sync.h
+/// \brief Declaration of the kernel synchronization primitives.
+///
+/// - Spinlocks are ticket locks: the processors get the lock in the order they asked for
+///   it. The _irqsave variants also disable the interruptions, they are needed for data
+///   shared with an interruption routine. Each lock counts its acquisitions, the ones
+///   that had to wait, the cycles spent waiting and the cycles it was held. The locks
+///   given to spinlock_init() are listed by sync_dump_stats().
+/// - Sequence locks protect read-mostly data: the writers take a spinlock and the readers
+///   never wait, they read again if a writer changed the data meanwhile.
+/// - Wait queues put tasks to sleep until a condition is true (see wait_event()). The
+///   waiting task is queued and blocked with task_block(), wake_up() moves the queued
+///   tasks to the woken list and the idle processor resumes them with task_resume(), so
+///   that they check their condition again. The kernel and the task it called can't
+///   block, there is nothing below them to return to: they are the idle point, they
+///   halt until the next interruption and resume the woken tasks meanwhile.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SYNC_H_
+#define _SYNC_H_
+
+#include "../common/types.h"
+#include "x86.h"
+
+typedef struct spinlock_st {
+    volatile uint32_t next;         // Next ticket given
+    volatile uint32_t owner;        // Ticket holding the lock
+    const char *name;
+    uint32_t acquired_at;           // Low word of the time-stamp counter
+    uint32_t nb_acquired;
+    uint32_t nb_contended;          // Acquisitions which had to wait
+    uint64_t spin_cycles;
+    uint64_t hold_cycles;
+    uint32_t max_hold_cycles;
+    struct spinlock_st *next_lock;  // List of sync_dump_stats()
+} spinlock_t;
+
+typedef struct seqlock_st {
+    volatile uint32_t sequence;     // Odd while a writer changes the data
+    spinlock_t lock;                // Serializes the writers
+} seqlock_t;
+
+typedef struct wait_queue_st {
+    const char *name;
+    struct task_st *first;          // Blocked tasks, linked through wait_next
+    struct task_st *last;
+    uint32_t nb_waits;              // Tasks blocked
+    uint32_t nb_halts;              // Halts of the tasks which can't block
+    uint32_t nb_wakeups;            // Tasks woken by wake_up()
+    struct wait_queue_st *next_queue;
+} wait_queue_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void spinlock_init(spinlock_t *lock, const char *name)
+/// \brief Initializes an unlocked spinlock and adds it to the statistics.
+///
+/// A zeroed spinlock is also unlocked, but isn't listed by sync_dump_stats().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void spinlock_init(spinlock_t *lock, const char *name);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void spin_lock(spinlock_t *lock)
+/// \brief Takes a spinlock, waiting for the processors which asked for it before.
+///
+/// The spinlock must not be taken by an interruption routine, see spin_lock_irqsave().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void spin_lock(spinlock_t *lock);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void spin_unlock(spinlock_t *lock)
+/// \brief Releases a spinlock taken by spin_lock().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void spin_unlock(spinlock_t *lock);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t spin_lock_irqsave(spinlock_t *lock)
+/// \brief Disables the interruptions then takes a spinlock.
+/// \return The flags to give to spin_unlock_irqrestore().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t spin_lock_irqsave(spinlock_t *lock);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
+/// \brief Releases a spinlock, then enables the interruptions if they were enabled
+///        before spin_lock_irqsave().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void seqlock_init(seqlock_t *seqlock, const char *name)
+/// \brief Initializes a sequence lock, its writer lock is listed by sync_dump_stats().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void seqlock_init(seqlock_t *seqlock, const char *name);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t write_seqlock_irqsave(seqlock_t *seqlock)
+/// \brief Starts changing the data protected by a sequence lock.
+///
+/// The interruptions are disabled: a reader interrupting the writer on the same
+/// processor would wait forever.
+///
+/// \return The flags to give to write_sequnlock_irqrestore().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t write_seqlock_irqsave(seqlock_t *seqlock);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void write_sequnlock_irqrestore(seqlock_t *seqlock, uint32_t flags)
+/// \brief Ends the changes started by write_seqlock_irqsave().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void write_sequnlock_irqrestore(seqlock_t *seqlock, uint32_t flags);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t read_seqbegin(const seqlock_t *seqlock)
+/// \brief Starts reading the data protected by a sequence lock.
+///
+/// Usage:
+///     do {
+///         sequence = read_seqbegin(&lock);
+///         ... copy the data ...
+///     } while (read_seqretry(&lock, sequence));
+///
+/// \return The sequence to give to read_seqretry().
+//////////////////////////////////////////////////////////////////////////////////////////
+static inline uint32_t read_seqbegin(const seqlock_t *seqlock)
+{
+    uint32_t sequence;
+    while ((sequence = seqlock->sequence) & 1)
+    {
+        cpu_relax();
+    }
+    asm volatile("" : : : "memory");
+    return sequence;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn bool read_seqretry(const seqlock_t *seqlock, uint32_t sequence)
+/// \brief Returns true if a writer changed the data since read_seqbegin(), the data must
+///        be read again.
+//////////////////////////////////////////////////////////////////////////////////////////
+static inline bool read_seqretry(const seqlock_t *seqlock, uint32_t sequence)
+{
+    asm volatile("" : : : "memory");
+    return seqlock->sequence != sequence;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void wait_queue_init(wait_queue_t *queue, const char *name)
+/// \brief Initializes an empty wait queue and lists its statistics.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void wait_queue_init(wait_queue_t *queue, const char *name);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void wait_queue_sleep(wait_queue_t *queue)
+/// \brief Blocks the current task on a wait queue until wake_up(), used by wait_event().
+///
+/// Called with the interruptions disabled, which are disabled again when it returns: a
+/// wake_up() from an interruption routine can't come between the test of the condition
+/// and the block. A task which can't block calls wait_queue_idle() instead.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void wait_queue_sleep(wait_queue_t *queue);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \def wait_event(queue, condition)
+/// \brief Sleeps on a wait queue and checks condition again each time the task is
+///        resumed, until it is true.
+///
+/// The condition is evaluated with the interruptions disabled. The code which makes it
+/// true calls wake_up().
+//////////////////////////////////////////////////////////////////////////////////////////
+#define wait_event(queue, condition)                \
+    do {                                            \
+        uint32_t _wait_flags = irq_save();          \
+        while (!(condition))                        \
+        {                                           \
+            wait_queue_sleep(queue);                \
+        }                                           \
+        irq_restore(_wait_flags);                   \
+    } while (0)
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void wake_up(wait_queue_t *queue)
+/// \brief Wakes the tasks of a wait queue, which are resumed by the idle processor.
+///
+/// Doesn't switch tasks: it can be called by an interruption routine.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void wake_up(wait_queue_t *queue);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void wait_queue_idle()
+/// \brief Halts the processor until its next interruption if no task is woken, then
+///        resumes the woken tasks.
+///
+/// Only called by the kernel or the task it called, with the interruptions disabled.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void wait_queue_idle();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void wait_queue_task_exit(struct task_st *task)
+/// \brief Removes a blocked task from its wait queue, when it is destroyed.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void wait_queue_task_exit(struct task_st *task);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void sync_reset_stats()
+/// \brief Clears the statistics of the listed spinlocks and wait queues.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void sync_reset_stats();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void sync_dump_stats()
+/// \brief Prints the statistics of the listed spinlocks and wait queues.
+///
+/// The spin and hold times are averages in cycles, the hottest locks have the highest
+/// contention and hold times.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void sync_dump_stats();
+
+#endif
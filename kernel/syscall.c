@@ -9,11 +9,36 @@
 #include "pfs.h"
 #include "timer.h"
 #include "gdt.h"
+#include "frame.h"
+#include "image.h"
+#include "kmalloc.h"
+#include "paging.h"
+#include "irq.h"
+#include "ipc.h"
+#include "latency.h"
+#include "pipe.h"
+#include "profiler.h"
+#include "shm.h"
+#include "sync.h"
+#include "trace.h"
 #include "../common/types.h"
+#include "../common/string.h"
 #include "../common/syscall_nb.h"
 
 #define UNUSED(x) ((void)(x))
 
+// Returns the input or the output of the calling task, NULL for the keyboard or the
+// screen.
+static struct pipe_st* task_pipe(bool output)
+{
+    task_t *task = current_task();
+    if (task == NULL)
+    {
+        return NULL;
+    }
+    return output ? task->pipe_out : task->pipe_in;
+}
+
 int syscall_putc(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
 {
     UNUSED(arg2);
@@ -21,7 +46,13 @@ int syscall_putc(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uin
     UNUSED(arg4);
     UNUSED(task_addr);
 
-    print_char((char) arg1);
+    char c = (char) arg1;
+    struct pipe_st *pipe = task_pipe(true);
+    if (pipe != NULL)
+    {
+        return pipe_write(pipe, &c, 1) == 1 ? 0 : -1;
+    }
+    print_char(c);
     return 0;
 }
 
@@ -31,10 +62,35 @@ int syscall_puts(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uin
     UNUSED(arg3);
     UNUSED(arg4);
 
-    print_str((char*)(task_addr + arg1));
+    char *str = (char*)(task_addr + arg1);
+    struct pipe_st *pipe = task_pipe(true);
+    if (pipe != NULL)
+    {
+        uint32_t length = strlen(str);
+        return length == 0 || pipe_write(pipe, str, length) == (int)length ? 0 : -1;
+    }
+    print_str(str);
     return 0;
 }
 
+int syscall_write(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg3);
+    UNUSED(arg4);
+
+    char *data = (char*)(task_addr + arg1);
+    struct pipe_st *pipe = task_pipe(true);
+    if (pipe != NULL)
+    {
+        return arg2 == 0 ? 0 : pipe_write(pipe, data, arg2);
+    }
+    for (uint32_t i = 0; i < arg2; i++)
+    {
+        print_char(data[i]);
+    }
+    return arg2;
+}
+
 int syscall_exec(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
 {
     UNUSED(arg2);
@@ -52,9 +108,41 @@ int syscall_getc(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uin
     UNUSED(arg4);
     UNUSED(task_addr);
 
+    struct pipe_st *pipe = task_pipe(false);
+    if (pipe != NULL)
+    {
+        uint8_t c;
+        return pipe_read(pipe, &c, 1) == 1 ? c : -1;
+    }
     return (int) getc();
 }
 
+int syscall_read(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg3);
+    UNUSED(arg4);
+
+    struct pipe_st *pipe = task_pipe(false);
+    if (pipe != NULL)
+    {
+        return pipe_read(pipe, (void*)(task_addr + arg1), arg2);
+    }
+    return (int) keyboard_read((char*)(task_addr + arg1), arg2);
+}
+
+int syscall_read_line(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg3);
+    UNUSED(arg4);
+
+    struct pipe_st *pipe = task_pipe(false);
+    if (pipe != NULL)
+    {
+        return pipe_read_line(pipe, (char*)(task_addr + arg1), arg2);
+    }
+    return (int) keyboard_read_line((char*)(task_addr + arg1), arg2);
+}
+
 int syscall_file_stat(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
 {
     UNUSED(arg3);
@@ -76,6 +164,12 @@ int syscall_file_remove(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t ar
     UNUSED(arg3);
     UNUSED(arg4);
 
+    // The cached image of the file must not be launched anymore
+    file_iterator_t it = find_file((char*)(task_addr + arg1));
+    if (it.boundToFile)
+    {
+        image_invalidate(it.index);
+    }
     return file_remove((char*)(task_addr + arg1));
 }
 
@@ -141,6 +235,298 @@ int syscall_set_cursor(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg
     return 0;
 }
 
+int syscall_profiler(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    switch (arg1)
+    {
+    case PROFILER_START:
+        profiler_start();
+        break;
+    case PROFILER_STOP:
+        profiler_stop();
+        break;
+    case PROFILER_RESET:
+        profiler_reset();
+        break;
+    case PROFILER_DUMP:
+        profiler_dump();
+        break;
+    default:
+        return -1;
+    }
+    return 0;
+}
+
+int syscall_trace_dump(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg1);
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+#ifdef TRACE
+    trace_dump();
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+int syscall_mem_stats(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg1);
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    frame_dump_stats();
+    kmalloc_dump_stats();
+    image_cache_dump_stats();
+    return 0;
+}
+
+// Sets the program break of the calling task to arg1 and returns it, or returns the
+// current break if arg1 is 0. The heap starts at the end of the task's data (bss), known
+// from the header of the program or set by the first call, it can't shrink below it nor
+// grow into the stack.
+int syscall_brk(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+
+    task_t *task = current_task();
+    if (task == NULL)
+    {
+        return -1;
+    }
+    if (arg1 == 0)
+    {
+        return task->brk;
+    }
+    if (arg1 < task->heap_start || arg1 > task->memory_size - task->stack_size)
+    {
+        return -1;
+    }
+
+    if (task->heap_start == 0)
+    {
+        task->heap_start = task->brk = arg1;
+    }
+
+    // The pages above the new break are given back, the ones below it are committed by
+    // the page fault handler when the task touches them
+    uint32_t new_end = (arg1 + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint32_t old_end = (task->brk + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if (new_end < old_end)
+    {
+        paging_release(task_addr + new_end, task_addr + old_end);
+    }
+
+    task->brk = arg1;
+    return arg1;
+}
+
+int syscall_fork(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg1);
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return fork_task();
+}
+
+// Prints the statistics of the kernel locks, or clears them if arg1 isn't 0.
+int syscall_lock_stats(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    if (arg1 != 0)
+    {
+        sync_reset_stats();
+    }
+    else
+    {
+        sync_dump_stats();
+    }
+    return 0;
+}
+
+int syscall_irq_stats(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg1);
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    irq_dump_stats();
+    return 0;
+}
+
+// Prints the irq-off and timer IRQ latencies, or clears them if arg1 isn't 0. Returns -1
+// if the kernel doesn't measure them.
+int syscall_latency_stats(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+#ifdef LATENCY
+    if (arg1 != 0)
+    {
+        latency_reset();
+    }
+    else
+    {
+        latency_dump();
+    }
+    return 0;
+#else
+    UNUSED(arg1);
+    return -1;
+#endif
+}
+
+int syscall_get_tsc_khz(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg1);
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return get_tsc_khz();
+}
+
+// Returns a message to the calling task in the registers it was passed in.
+static void set_message_registers(ipc_msg_t *msg)
+{
+    syscall_frame_t *frame = task_syscall_frame(current_task());
+    frame->ecx = msg->data[0];
+    frame->edx = msg->data[1];
+    frame->esi = msg->pages;
+}
+
+int syscall_port_create(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg1);
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return ipc_port_create();
+}
+
+// The message is in arg2 to arg4 (ecx, edx and esi), its pages are in the task memory
+int syscall_port_send(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(task_addr);
+
+    ipc_msg_t msg = { { arg2, arg3 }, arg4 };
+    int result = ipc_send(arg1, &msg);
+    if (result == 0)
+    {
+        set_message_registers(&msg);
+    }
+    return result;
+}
+
+int syscall_port_receive(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(task_addr);
+
+    ipc_msg_t msg = { { arg2, arg3 }, arg4 };
+    int result = ipc_receive(arg1, &msg);
+    if (result == 0)
+    {
+        set_message_registers(&msg);
+    }
+    return result;
+}
+
+int syscall_port_reply(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(task_addr);
+
+    ipc_msg_t msg = { { arg2, arg3 }, arg4 };
+    return ipc_reply(arg1, &msg);
+}
+
+int syscall_pipe_create(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg1);
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return pipe_create();
+}
+
+int syscall_pipe_close(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return pipe_close(arg1);
+}
+
+int syscall_pipe_redirect(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return pipe_redirect(arg1, arg2 != 0);
+}
+
+int syscall_wait(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return wait_task((int) arg1);
+}
+
+int syscall_shm_create(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg2);
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return shm_create(arg1);
+}
+
+// The address is in the task memory, not a pointer to its data
+int syscall_shm_map(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, uint32_t task_addr)
+{
+    UNUSED(arg3);
+    UNUSED(arg4);
+    UNUSED(task_addr);
+
+    return shm_map(arg1, arg2);
+}
+
 // Table containing pointers to all the syscall functions
 int (*syscall_functions[__SYSCALL_END__])(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t) = {
     syscall_putc,
@@ -155,7 +541,29 @@ int (*syscall_functions[__SYSCALL_END__])(uint32_t, uint32_t, uint32_t, uint32_t
     syscall_get_ticks,
     syscall_sleep,
     syscall_clear_screen,
-    syscall_set_cursor
+    syscall_set_cursor,
+    syscall_profiler,
+    syscall_trace_dump,
+    syscall_mem_stats,
+    syscall_brk,
+    syscall_fork,
+    syscall_lock_stats,
+    syscall_read_line,
+    syscall_irq_stats,
+    syscall_latency_stats,
+    syscall_get_tsc_khz,
+    syscall_port_create,
+    syscall_port_send,
+    syscall_port_receive,
+    syscall_port_reply,
+    syscall_pipe_create,
+    syscall_pipe_close,
+    syscall_pipe_redirect,
+    syscall_read,
+    syscall_write,
+    syscall_wait,
+    syscall_shm_create,
+    syscall_shm_map
 };
 
 // System call handler: call the appropriate system call according to the nb argument.
@@ -166,5 +574,14 @@ int syscall_handler(syscall_t nb, uint32_t arg1, uint32_t arg2, uint32_t arg3, u
     {
         return -1;
     }
-    return syscall_functions[nb](arg1, arg2, arg3, arg4, (uint32_t)get_task(caller_tss_selector)->memory);
+
+    // The memory of the calling task is mapped at the same address in every task, the
+    // syscall runs with its page directory
+    UNUSED(caller_tss_selector);
+
+    TRACE_EVENT(TRACE_SYSCALL_ENTRY, nb);
+    int result = syscall_functions[nb](arg1, arg2, arg3, arg4, PAGING_USER_BASE);
+    TRACE_EVENT(TRACE_SYSCALL_EXIT, nb);
+
+    return result;
 }
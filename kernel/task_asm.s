@@ -1,5 +1,8 @@
 global load_task_register
 global call_task
+global return_task
+
+EFLAGS_NT equ 0x4000    ; nested task flag
 
 section .data
 tss_sel_offs dd 0  ; must always be 0
@@ -28,3 +31,19 @@ call_task:
     mov     [ecx],ax
     call    far [ecx-4]
     ret
+
+; Return to the task which called the current one, like the iret of an exiting task,
+; from the kernel. The trap gate of the system calls cleared the nested task flag, it
+; is set again for the iret to switch tasks. The state of the current task is saved in
+; its TSS: it resumes after the iret when it is called again, with the flag set by the
+; call, which is cleared for the iret ending its system call.
+; void return_task()
+return_task:
+    pushfd
+    or      dword [esp],EFLAGS_NT
+    popfd
+    iret
+    pushfd
+    and     dword [esp],~EFLAGS_NT
+    popfd
+    ret
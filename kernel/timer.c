@@ -8,16 +8,50 @@
 
 #include "timer.h"
 
+#include "irq.h"
 #include "x86.h"
 #include "periph.h"
+#include "sync.h"
 
 #define FREQ_MIN 19
 #define FREQ_MAX 1193180
+#define NO_WAKEUP ((uint64_t)-1)  // next_wakeup without sleeper
+
+#define PIT_CHANNEL_0   0x40
+#define PIT_COMMAND     0x43
+#define PIT_RATE_MODE   0x34    // Channel 0, low then high byte, mode 2
+#define PIT_LATCH       0x00    // Channel 0, latches the counter
 
 //////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
 
 static uint32_t freq = 0;    // Frequence in [Hz]
-static uint32_t ticks = 0;   // Ticks counter
+static uint16_t divider = 0;
+static uint64_t ticks = 0;   // Ticks counter, read without lock through the seqlock
+static seqlock_t ticks_lock;
+static wait_queue_t sleepers;
+static uint64_t next_wakeup = NO_WAKEUP;    // Earliest end of the sleeps, changed with
+                                            // the interruptions disabled
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Timer interruption routine, counts the ticks.
+static bool timer_handler(regs_t *regs, void *data)
+{
+    (void)regs;
+    (void)data;
+
+    uint32_t flags = write_seqlock_irqsave(&ticks_lock);
+	ticks++;
+    write_sequnlock_irqrestore(&ticks_lock, flags);
+
+    // All the sleepers are woken, the ones which sleep longer set next_wakeup again
+    if (ticks >= next_wakeup)
+    {
+        next_wakeup = NO_WAKEUP;
+        wake_up(&sleepers);
+    }
+    return true;
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////
 void timer_init(uint32_t freq_hz)
@@ -32,33 +66,99 @@ void timer_init(uint32_t freq_hz)
         freq_hz = FREQ_MAX;
     }
     
-	// Sets the divider in the timer peripheral
-	uint16_t divider = FREQ_MAX / freq_hz;
+	// Sets the divider in the timer peripheral. In rate generator mode, the counter goes
+	// down from the divider to 1 once per tick, see timer_since_tick_ns()
+	divider = FREQ_MAX / freq_hz;
 	
-    outb(0x43, 0x36);
-    outb(0x40, (uint8_t)(divider & 0xFF));
-    outb(0x40, (uint8_t)(divider >> 8));
+    outb(PIT_COMMAND, PIT_RATE_MODE);
+    outb(PIT_CHANNEL_0, (uint8_t)(divider & 0xFF));
+    outb(PIT_CHANNEL_0, (uint8_t)(divider >> 8));
 
+    seqlock_init(&ticks_lock, "ticks");
+    wait_queue_init(&sleepers, "sleep");
     freq = freq_hz;
     ticks = 0;
+    irq_register(0, timer_handler, NULL, "timer");
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
-void timer_handler()
+uint32_t get_ticks()
 {
-	ticks++;
+	return (uint32_t)get_ticks64();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
-uint32_t get_ticks()
+uint64_t get_ticks64()
 {
-	return ticks;
+    uint64_t result;
+    uint32_t sequence;
+    do
+    {
+        sequence = read_seqbegin(&ticks_lock);
+        result = ticks;
+    } while (read_seqretry(&ticks_lock, sequence));
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t get_timer_freq()
+{
+	return freq;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t timer_since_tick_ns()
+{
+    if (divider == 0)
+    {
+        return 0;
+    }
+
+    uint32_t flags = irq_save();
+    outb(PIT_COMMAND, PIT_LATCH);
+    uint32_t count = inb(PIT_CHANNEL_0);
+    count |= inb(PIT_CHANNEL_0) << 8;
+    irq_restore(flags);
+
+    uint32_t elapsed = count <= divider ? divider - count : 0;
+    return div64((uint64_t)elapsed * 1000000000, FREQ_MAX);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint32_t get_tsc_khz()
+{
+    static uint32_t tsc_khz = 0;
+
+    if (tsc_khz == 0)
+    {
+        // Synchronizes on a tick edge, then counts the cycles during 10 ticks
+        uint32_t start = get_ticks();
+        while (start == get_ticks());
+
+        uint64_t tsc_start = rdtsc();
+        start = get_ticks();
+        while (get_ticks() - start < 10);
+        uint32_t cycles = (uint32_t)(rdtsc() - tsc_start);
+
+        // Avoids 64-bit divisions and overflows (not available without libgcc)
+        tsc_khz = cycles / 10 / 1000 * freq;
+    }
+    return tsc_khz;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 void sleep(uint32_t ms)
 {
-    uint32_t stop = ticks + (ms * freq / 1000);
-    while (stop > ticks);
+    uint64_t stop = get_ticks64() + ms * freq / 1000;
+    uint32_t flags = irq_save();
+    while (get_ticks64() < stop)
+    {
+        if (stop < next_wakeup)
+        {
+            next_wakeup = stop;
+        }
+        wait_queue_sleep(&sleepers);
+    }
+    irq_restore(flags);
 }
 
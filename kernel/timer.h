@@ -15,21 +15,12 @@
 /// \fn void timer_init(uint32_t freq_hz)
 /// \brief Initializes the timer.
 ///
-/// Initializes the timer and sets its tick frequency.
+/// Initializes the timer, sets its tick frequency and registers its handler on IRQ 0.
 ///
 /// \param freq_hz : Ticks frequency [Hz].
 //////////////////////////////////////////////////////////////////////////////////////////
 extern void timer_init(uint32_t freq_hz);
 
-//////////////////////////////////////////////////////////////////////////////////////////
-/// \fn void timer_handler()
-/// \brief Timer interruption routine.
-///
-/// This function is called when a timer interuption occurs. It increment the ticks
-/// counter.
-//////////////////////////////////////////////////////////////////////////////////////////
-extern void timer_handler();
-
 //////////////////////////////////////////////////////////////////////////////////////////
 /// \fn uint32_t get_ticks()
 /// \brief Returns the number of ticks.
@@ -40,9 +31,45 @@ extern void timer_handler();
 //////////////////////////////////////////////////////////////////////////////////////////
 extern uint32_t get_ticks();
 
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint64_t get_ticks64()
+/// \brief Returns the number of ticks without wrapping around.
+///
+/// The counter is protected by a sequence lock: reading it never delays the timer
+/// interruption.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint64_t get_ticks64();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t get_timer_freq()
+/// \brief Returns the tick frequency set by timer_init() [Hz].
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t get_timer_freq();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t timer_since_tick_ns()
+/// \brief Returns the time elapsed since the last tick was raised, read from the counter
+///        of the timer [ns].
+///
+/// The tick may not be counted yet, if its IRQ is pending. Returns 0 before timer_init().
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t timer_since_tick_ns();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint32_t get_tsc_khz()
+/// \brief Returns the frequency of the time-stamp counter in kHz.
+///
+/// The frequency is measured against the timer the first time this function is called,
+/// which takes 10 ticks. Interruptions must be enabled.
+///
+/// \return TSC frequency [kHz].
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint32_t get_tsc_khz();
+
 //////////////////////////////////////////////////////////////////////////////////////////
 /// \fn void sleep(uint32_t ms)
-/// \brief Waits a certain ammount of mulliseconds (active waiting).
+/// \brief Waits a certain ammount of mulliseconds, blocked on the wait queue of the
+///        sleepers (see sync.h).
 /// \param ms : Duration of the sleep in milliseconds.
 //////////////////////////////////////////////////////////////////////////////////////////
 extern void sleep(uint32_t ms);
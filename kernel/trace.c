@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file trace.c
+/// \brief Implementation of the kernel event tracing facility.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "trace.h"
+
+#include "gdt.h"
+#include "serial.h"
+#include "smp.h"
+#include "timer.h"
+#include "x86.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct trace_buffer_t
+/// \brief Ring buffer of events of one CPU.
+///
+/// head only ever increases: a writer reserves a slot by atomically incrementing it, so
+/// interruption routines can record events while a lower priority context is recording.
+/// The sequence of an event is written last, the reader only keeps the events whose
+/// sequence matches before and after it copied them.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct trace_buffer_st {
+    trace_event_t events[TRACE_NB_EVENTS];
+    uint32_t head;      // Number of events ever recorded
+    uint32_t tail;      // Number of events already dumped
+    bool paused;        // Set while the buffer is dumped
+} trace_buffer_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static trace_buffer_t buffers[MAX_NB_CPUS];
+
+static char *type_names[__TRACE_END__] = {
+    "irq_entry",
+    "irq_exit",
+    "syscall_entry",
+    "syscall_exit",
+    "read_sector_begin",
+    "read_sector_end",
+    "write_sector_begin",
+    "write_sector_end",
+    "exec_begin",
+    "exec_end",
+    "task_switch",
+    "task_return",
+    "fork_begin",
+    "fork_end"
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void trace_record(trace_type_t type, uint32_t arg)
+{
+    trace_buffer_t *buffer = &buffers[smp_cpu_id()];
+    if (buffer->paused)
+    {
+        return;
+    }
+
+    uint32_t number = __sync_fetch_and_add(&buffer->head, 1);
+    trace_event_t *event = &buffer->events[number & (TRACE_NB_EVENTS - 1)];
+    task_t *task = current_task();
+
+    event->sequence = 0;
+    barrier();
+    event->tsc = rdtsc();
+    event->type = type;
+    event->task = task == NULL ? -1 : task_index(task);
+    event->arg = arg;
+    barrier();
+    event->sequence = number + 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void trace_dump()
+{
+    uint32_t nb_cpus = smp_nb_cpus();
+    serial_printf("# trace cpus=%u tsc_khz=%u\n", nb_cpus, get_tsc_khz());
+
+    for (uint32_t cpu = 0; cpu < nb_cpus; cpu++)
+    {
+        trace_buffer_t *buffer = &buffers[cpu];
+        buffer->paused = true;
+        barrier();
+
+        // Skip the events that have been overwritten. The ones reserved from now on are
+        // dumped next time
+        uint32_t head = buffer->head;
+        uint32_t lost = 0;
+        if (head - buffer->tail > TRACE_NB_EVENTS)
+        {
+            lost = head - buffer->tail - TRACE_NB_EVENTS;
+            buffer->tail = head - TRACE_NB_EVENTS;
+        }
+        serial_printf("# cpu=%u events=%u lost=%u\n", cpu, head - buffer->tail, lost);
+
+        for (; buffer->tail != head; buffer->tail++)
+        {
+            // Copied first, the writer may still be filling it
+            trace_event_t *slot = &buffer->events[buffer->tail & (TRACE_NB_EVENTS - 1)];
+            uint32_t sequence = slot->sequence;
+            barrier();
+            trace_event_t event = *slot;
+            barrier();
+            if (sequence != buffer->tail + 1 || slot->sequence != sequence)
+            {
+                serial_printf("# cpu=%u event %u lost while written\n", cpu, buffer->tail);
+                continue;
+            }
+
+            serial_printf("T %u %x %x %s %d %u\n", cpu, (uint32_t)(event.tsc >> 32),
+                          (uint32_t)event.tsc, type_names[event.type], event.task, event.arg);
+        }
+
+        buffer->paused = false;
+    }
+}
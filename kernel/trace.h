@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file trace.h
+/// \brief Declaration of the kernel event tracing facility.
+///
+/// Tracepoints are placed with the TRACE_EVENT macro. They are only compiled in when the
+/// kernel is built with TRACE defined (make TRACE=1), otherwise they expand to nothing.
+/// Each event is timestamped with the TSC and stored in the ring buffer of the CPU that
+/// recorded it. The buffers are dumped on the serial port and converted to the Chrome
+/// trace format by tools/trace2json.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "../common/types.h"
+
+#define TRACE_NB_EVENTS     4096    // Per CPU, must be a power of two
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \enum trace_type_t
+/// \brief Types of the traced events.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef enum {
+    TRACE_IRQ_ENTRY = 0,        ///< arg : IRQ number
+    TRACE_IRQ_EXIT,             ///< arg : IRQ number
+    TRACE_SYSCALL_ENTRY,        ///< arg : system call number
+    TRACE_SYSCALL_EXIT,         ///< arg : system call number
+    TRACE_READ_SECTOR_BEGIN,    ///< arg : sector
+    TRACE_READ_SECTOR_END,      ///< arg : sector
+    TRACE_WRITE_SECTOR_BEGIN,   ///< arg : sector
+    TRACE_WRITE_SECTOR_END,     ///< arg : sector
+    TRACE_EXEC_BEGIN,           ///< arg : index of the task slot
+    TRACE_EXEC_END,             ///< arg : index of the task slot
+    TRACE_TASK_SWITCH,          ///< arg : index of the task switched to
+    TRACE_TASK_RETURN,          ///< arg : index of the task that returned
+    TRACE_FORK_BEGIN,           ///< arg : index of the task slot of the child
+    TRACE_FORK_END,             ///< arg : index of the task slot of the child
+
+    __TRACE_END__
+} trace_type_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct trace_event_t
+/// \brief A traced event.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct trace_event_st {
+    uint64_t tsc;       ///< Time-stamp counter when the event was recorded
+    uint16_t type;      ///< One of trace_type_t
+    int16_t  task;      ///< Index of the running task, -1 for the kernel
+    uint32_t arg;       ///< Argument of the event (see trace_type_t)
+    volatile uint32_t sequence; ///< Number of the event + 1, 0 while it is written
+} trace_event_t;
+
+#ifdef TRACE
+#define TRACE_EVENT(type, arg) trace_record((type), (uint32_t)(arg))
+#else
+#define TRACE_EVENT(type, arg) ((void)0)
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void trace_record(trace_type_t type, uint32_t arg)
+/// \brief Records an event in the ring buffer of the current CPU.
+///
+/// Use the TRACE_EVENT macro instead so the tracepoint disappears when tracing is
+/// disabled. When the ring buffer is full, the oldest events are overwritten. This
+/// function takes no lock and can be called from any context, including interruption
+/// routines.
+///
+/// \param type : Type of the event.
+/// \param arg : Argument of the event.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void trace_record(trace_type_t type, uint32_t arg);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void trace_dump()
+/// \brief Dumps the recorded events on the serial port and clears the buffers.
+///
+/// The output starts with a "# trace" header giving the TSC frequency, followed by one
+/// line per event :
+///
+///     T <cpu> <tsc high> <tsc low> <type name> <task> <arg>
+///
+/// The TSC halves are hexadecimal, the other values decimal. Only the buffers of the
+/// running CPUs are dumped. Nothing is recorded in a buffer while it is dumped, and an
+/// event still being written by another CPU is skipped and counted as lost.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void trace_dump();
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef _X86_H_
 #define _X86_H_
 
+#include "../common/types.h"
+
 // Privilege levels
 #define DPL_USER    0x3
 #define DPL_KERNEL  0x0
@@ -36,16 +38,135 @@
 #define GDT_KERNEL_CODE_SELECTOR  0x08
 #define GDT_KERNEL_DATA_SELECTOR  0x10
 
+// Interrupt enable flag of EFLAGS
+#define EFLAGS_IF   (1 << 9)
+
+// Hooks of the irq-off measurement, only called with LATENCY defined (see latency.h).
+// The site of a region is the return address of the function which disabled the
+// interruptions, i.e. its caller: the functions below aren't inlined without -O.
+#ifdef LATENCY
+extern void latency_irqs_off(const void *site);
+extern void latency_irqs_on();
+#define LATENCY_IRQS_OFF()  latency_irqs_off(__builtin_return_address(0))
+#define LATENCY_IRQS_ON()   latency_irqs_on()
+#else
+#define LATENCY_IRQS_OFF()  ((void)0)
+#define LATENCY_IRQS_ON()   ((void)0)
+#endif
+
 // Disable hardware interrupts.
 static inline void cli() {
     asm volatile("cli");
+    LATENCY_IRQS_OFF();
 }
 
 // Enable hardware interrupts.
 static inline void sti() {
+    LATENCY_IRQS_ON();
     asm volatile("sti");
 }
 
+// Read the time-stamp counter.
+static inline uint64_t rdtsc() {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+// Return the selector currently loaded in the task register.
+static inline uint16_t get_task_register() {
+    uint16_t tr;
+    asm volatile("str %0" : "=r"(tr));
+    return tr;
+}
+
+// Return the linear address that caused the last page fault.
+static inline uint32_t read_cr2() {
+    uint32_t cr2;
+    asm volatile("mov %%cr2, %0" : "=r"(cr2));
+    return cr2;
+}
+
+// Return the physical address of the current page directory.
+static inline uint32_t read_cr3() {
+    uint32_t cr3;
+    asm volatile("mov %%cr3, %0" : "=r"(cr3));
+    return cr3;
+}
+
+// Switch to another page directory, which flushes the TLB.
+static inline void write_cr3(uint32_t cr3) {
+    asm volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
+}
+
+// Invalidate the TLB entry of the page containing a linear address.
+static inline void invlpg(uint32_t address) {
+    asm volatile("invlpg (%0)" : : "r"(address) : "memory");
+}
+
+// Disable hardware interrupts and return the previous EFLAGS, to be passed to
+// irq_restore() at the end of the critical section.
+static inline uint32_t irq_save() {
+    uint32_t flags;
+    asm volatile("pushf\n pop %0\n cli" : "=r"(flags) : : "memory");
+    if (flags & EFLAGS_IF) {
+        LATENCY_IRQS_OFF();
+    }
+    return flags;
+}
+
+// Enable hardware interrupts again if they were enabled when irq_save() was called.
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        sti();
+    }
+}
+
+// Atomically store value in *address and return the previous value.
+static inline uint32_t atomic_xchg(volatile uint32_t *address, uint32_t value) {
+    asm volatile("xchg %0, %1" : "+r"(value), "+m"(*address) : : "memory");
+    return value;
+}
+
+// Atomically add value to *address and return the previous value.
+static inline uint32_t atomic_add(volatile uint32_t *address, uint32_t value) {
+    asm volatile("lock xadd %0, %1" : "+r"(value), "+m"(*address) : : "memory");
+    return value;
+}
+
+// Prevent the compiler from moving memory accesses across this point. The processor
+// itself keeps the order of the loads and the order of the stores.
+static inline void barrier() {
+    asm volatile("" : : : "memory");
+}
+
+// Hint to the processor that the code is busy waiting (spin loop).
+static inline void cpu_relax() {
+    asm volatile("pause" : : : "memory");
+}
+
+// Divide a 64-bit value by a 32-bit one without libgcc. Saturate if the quotient
+// doesn't fit in 32 bits.
+static inline uint32_t div64(uint64_t n, uint32_t d) {
+    uint32_t high = (uint32_t)(n >> 32);
+    uint32_t low = (uint32_t)n;
+    uint32_t quotient, remainder;
+
+    if (high >= d) {
+        return 0xFFFFFFFF;
+    }
+    asm("divl %4" : "=a"(quotient), "=d"(remainder) : "a"(low), "d"(high), "rm"(d));
+    return quotient;
+}
+
+// Sleep until the next interruption, with the interruptions disabled before and after.
+// sti only takes effect after hlt, no interruption can be lost in between.
+static inline void sti_hlt_cli() {
+    LATENCY_IRQS_ON();
+    asm volatile("sti\nhlt\ncli" : : : "memory");
+    LATENCY_IRQS_OFF();
+}
+
 // Halt the processor.
 // External interrupts wake up the CPU, hence the cli instruction.
 static inline void halt() {
@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file disk.c
+/// \brief Implementation of the file-backed stand-in for the IDE driver.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "disk.h"
+
+#include "../kernel/ide.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint64_t disk_reads = 0;
+uint64_t disk_writes = 0;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static uint8_t *image = NULL;
+static size_t image_size = 0;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Aborts the program if the sector is outside of the image, the kernel would read
+// garbage from the disk controller in that case.
+static void check_sector(int sector)
+{
+    if (image == NULL || sector < 0 || (size_t)(sector + 1) * SECTOR_SIZE > image_size)
+    {
+        fprintf(stderr, "Error: Access to sector %d outside of the image (%zu sectors).\n",
+                sector, image_size / SECTOR_SIZE);
+        abort();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int disk_open(const char *path)
+{
+    int fd = open(path, O_RDWR);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    image_size = st.st_size;
+    image = mmap(NULL, image_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        image = NULL;
+        return -1;
+    }
+    disk_reset_counters();
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void disk_close()
+{
+    if (image != NULL)
+    {
+        munmap(image, image_size);
+        image = NULL;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint8_t* disk_sector(uint32_t sector)
+{
+    check_sector(sector);
+    return image + (size_t)sector * SECTOR_SIZE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void disk_reset_counters()
+{
+    disk_reads = disk_writes = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void read_sector(int sector, void *dst)
+{
+    check_sector(sector);
+    memcpy(dst, image + (size_t)sector * SECTOR_SIZE, SECTOR_SIZE);
+    disk_reads++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void write_sector(int sector, void *src)
+{
+    check_sector(sector);
+    memcpy(image + (size_t)sector * SECTOR_SIZE, src, SECTOR_SIZE);
+    disk_writes++;
+}
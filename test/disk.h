@@ -0,0 +1,44 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file disk.h
+/// \brief File-backed stand-in for the IDE driver of the kernel.
+///
+/// disk.c implements read_sector() and write_sector() (see kernel/ide.h) on top of a
+/// PFS image file mapped in memory, so kernel/pfs.c can run unchanged on the host.
+/// Writes go straight to the image file.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _DISK_H_
+#define _DISK_H_
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int disk_open(const char *path)
+/// \brief Maps an image file as the disk used by read_sector() and write_sector().
+/// \param path : Path to the image file (opened for reading and writing).
+/// \return 0 on success or -1 if the file can't be mapped.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern int disk_open(const char *path);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void disk_close()
+/// \brief Unmaps the image file, flushing the written sectors.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void disk_close();
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn uint8_t* disk_sector(uint32_t sector)
+/// \brief Returns a pointer to a sector of the image, to check its raw content.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern uint8_t* disk_sector(uint32_t sector);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn void disk_reset_counters()
+/// \brief Sets the sector read and write counters to zero.
+//////////////////////////////////////////////////////////////////////////////////////////
+extern void disk_reset_counters();
+
+extern uint64_t disk_reads;     ///< Number of sectors read since the last reset
+extern uint64_t disk_writes;    ///< Number of sectors written since the last reset
+
+#endif
@@ -0,0 +1,24 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file host.h
+/// \brief Renames the kernel's libc-like functions when they are built for the host.
+///
+/// This header is force-included (-include host.h) in every kernel or common source
+/// compiled for the host, so that their memcpy, strlen, ... don't clash with the host C
+/// library. The test programs include it before ../common/string.h to call them.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _HOST_H_
+#define _HOST_H_
+
+#define memset  kernel_memset
+#define memcpy  kernel_memcpy
+#define strncmp kernel_strncmp
+#define strcmp  kernel_strcmp
+#define strncpy kernel_strncpy
+#define strlen  kernel_strlen
+#define split   kernel_split
+#define atoi    kernel_atoi
+#define itoa    kernel_itoa
+#define utoa    kernel_utoa
+
+#endif
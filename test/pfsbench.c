@@ -0,0 +1,171 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file pfsbench.c
+/// \brief Source of the pfsbench program.
+///
+/// pfsbench times the file system functions of kernel/pfs.c on the host, on an image
+/// made by pfsfill. Each result is printed as
+///
+///     BENCH <name> <iterations> <ns/op> <sectors read/op>
+///
+/// which tools/benchcmp can compare with a previous run. The image is modified (all the
+/// files are removed at the end), run it on a copy.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#define _POSIX_C_SOURCE 200809L  // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host.h"
+#include "disk.h"
+#include "../common/string.h"
+#include "../kernel/ide.h"
+#include "../kernel/pfs.h"
+
+#define DEFAULT_ITERATIONS 100
+
+static char *imageName;
+static uint32_t nbFiles;
+
+void printHelp(char *argv[])
+{
+    printf("How to : %s <image_file> [<iterations>]\n", argv[0]);
+    printf("With   : image_file : Image made by pfsfill, modified by the benchmark.\n");
+    printf("         iterations : Number of runs of each operation (default: %d).\n",
+           DEFAULT_ITERATIONS);
+}
+
+static uint64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void report(const char *name, uint32_t iterations, uint64_t start)
+{
+    uint64_t elapsed = now() - start;
+    printf("BENCH %s_%u %u %llu %llu\n", name, nbFiles, iterations,
+           (unsigned long long)(elapsed / iterations),
+           (unsigned long long)(disk_reads / iterations));
+}
+
+static void fileName(char *name, uint32_t index)
+{
+    snprintf(name, 32, "file%05u", index);
+}
+
+static void benchFind(const char *benchName, char *name, uint32_t iterations)
+{
+    disk_reset_counters();
+    uint64_t start = now();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        find_file(name);
+    }
+    report(benchName, iterations, start);
+}
+
+int main(int argc, char *argv[])
+{
+    // Check number of arguments
+    if (argc < 2)
+    {
+        printf("Error: Not enough arguments.\n");
+        printHelp(argv);
+        return 1;
+    }
+    imageName = argv[1];
+    uint32_t iterations = argc > 2 ? (uint32_t)atoi(argv[2]) : DEFAULT_ITERATIONS;
+    if (disk_open(imageName) == -1 || iterations == 0)
+    {
+        printf("Error: Couldn't open the image file '%s'.\n", imageName);
+        printHelp(argv);
+        return 1;
+    }
+
+    superblock_init();
+    nbFiles = ((Superblock*)disk_sector(0))->nbFileEntries;
+
+    char first[32], middle[32], last[32];
+    fileName(first, 0);
+    fileName(middle, nbFiles / 2);
+    fileName(last, nbFiles - 1);
+
+    stat_t stat;
+    if (file_stat(last, &stat) == -1)
+    {
+        printf("Error: '%s' wasn't made by pfsfill.\n", imageName);
+        return 1;
+    }
+    uint8_t *buffer = malloc(stat.size);
+
+    printf("# pfsbench image=%s files=%u file_size=%u unit=ns\n", imageName, nbFiles,
+           stat.size);
+
+    benchFind("pfs_find_first", first, iterations);
+    benchFind("pfs_find_middle", middle, iterations);
+    benchFind("pfs_find_last", last, iterations);
+    benchFind("pfs_find_missing", "missing", iterations);
+
+    disk_reset_counters();
+    uint64_t start = now();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        file_stat(last, &stat);
+    }
+    report("pfs_stat_last", iterations, start);
+
+    disk_reset_counters();
+    start = now();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        file_read(last, buffer);
+    }
+    report("pfs_read_last", iterations, start);
+
+    // Check the content, in case the read went wrong
+    for (uint32_t j = 0; j < stat.size; j++)
+    {
+        if (buffer[j] != (uint8_t)((nbFiles - 1) * 31 + j))
+        {
+            printf("Error: Wrong content read from '%s' at offset %u.\n", last, j);
+            return 1;
+        }
+    }
+
+    disk_reset_counters();
+    start = now();
+    uint32_t index = 0;
+    file_iterator_t it = file_iterator();
+    while (file_next(middle, &it))
+    {
+        index++;
+    }
+    report("pfs_list", 1, start);
+
+    // Remove the files starting with the last one: each lookup scans the whole table
+    disk_reset_counters();
+    start = now();
+    for (uint32_t i = nbFiles; i-- > 0;)
+    {
+        fileName(middle, i);
+        if (file_remove(middle) == -1)
+        {
+            printf("Error: Couldn't remove '%s'.\n", middle);
+            return 1;
+        }
+    }
+    report("pfs_remove_all", nbFiles, start);
+
+    if (index != nbFiles || file_iterator().boundToFile || file_next(middle, &it) != 0)
+    {
+        printf("Error: The image isn't consistent.\n");
+        return 1;
+    }
+
+    free(buffer);
+    disk_close();
+    return 0;
+}
@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file pfsfill.c
+/// \brief Source of the pfsfill program.
+///
+/// pfsfill creates a PFS image holding many generated files, which would take too long
+/// with one pfsadd call per file. The files are named file00000, file00001, ... and
+/// byte j of file i is (i * 31 + j) & 0xFF, so that pfsbench can check what it reads.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../tools/pfs.h"
+
+void printHelp(char *argv[])
+{
+    printf("How to : %s <image_file> <block_size> <nb_files> <file_size>\n", argv[0]);
+    printf("With   : image_file : Path to the image file to create.\n");
+    printf("         block_size : Size of blocks in bytes (greater than zero and divisible by 512).\n");
+    printf("         nb_files   : Number of files to create (greater than zero).\n");
+    printf("         file_size  : Size of each file in bytes (greater than zero).\n");
+}
+
+int main(int argc, char *argv[])
+{
+    // Check number of arguments
+    if (argc < 5)
+    {
+        printf("Error: Not enough arguments.\n");
+        printHelp(argv);
+        return 1;
+    }
+
+    // Retreive arguments
+    FILE *file = fopen(argv[1], "wb");
+    uint32_t blockSize = atoi(argv[2]);
+    uint32_t nbFiles = atoi(argv[3]);
+    uint32_t fileSize = atoi(argv[4]);
+    uint32_t blocksPerFile = (fileSize + blockSize - 1) / blockSize;
+
+    // Check arguments validity
+    if (file == NULL)
+    {
+        printf("Error: Couldn't create a file.\n");
+        printHelp(argv);
+        return 1;
+    }
+    if (blockSize == 0 || blockSize % SECTOR_SIZE > 0 || nbFiles == 0 || fileSize == 0)
+    {
+        printf("Error: Invalid arguments.\n");
+        printHelp(argv);
+        return 1;
+    }
+    if (blocksPerFile > FILE_ENTRY_NB_BLOCK_INDEX)
+    {
+        printf("Error: file_size is too big for a file entry.\n");
+        return 1;
+    }
+    // Data block 0 is never allocated and block indexes are 16 bits
+    if ((uint64_t)nbFiles * blocksPerFile + 1 > 0xFFFF)
+    {
+        printf("Error: Too many data blocks needed.\n");
+        return 1;
+    }
+
+    Superblock *sb = createSuperblock(blockSize, nbFiles, nbFiles * blocksPerFile + 1);
+    PFS *fs = createPFS(sb);
+
+    for (uint32_t i = 0; i < nbFiles; i++)
+    {
+        FileEntry *fe = &(fs->fileEntries[i]);
+        snprintf((char*)fe->fileName, sizeof(fe->fileName), "file%05u", i);
+        fe->fileSize = fileSize;
+
+        for (uint32_t j = 0; j < fileSize; j++)
+        {
+            if (j % blockSize == 0)
+            {
+                fe->dataBlocks[j / blockSize] = allocDataBlock(fs);
+            }
+            fs->data[fe->dataBlocks[j / blockSize] * blockSize + j % blockSize] = (i * 31 + j) & 0xFF;
+        }
+    }
+
+    writePFS(fs, file);
+
+    // Free the resources
+    fclose(file);
+    destroyPFS(fs);
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file pfstest.c
+/// \brief Source of the pfstest program.
+///
+/// pfstest runs kernel/pfs.c and common/string.c on the host. The file system functions
+/// are checked against an image made by tools/pfscreate and tools/pfsadd: the content of
+/// every file read by the kernel code must match the host file it was added from.
+/// The image is modified (files are removed), run it on a copy.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>     // memcmp, the other functions are the kernel's ones
+
+#include "host.h"
+#include "disk.h"
+#include "../common/string.h"
+#include "../kernel/ide.h"
+#include "../kernel/pfs.h"
+
+#define CANARY 0xA5
+
+static int nbChecks = 0;
+static int nbFailures = 0;
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+static void check(int condition, const char *text, const char *file, int line)
+{
+    nbChecks++;
+    if (!condition)
+    {
+        nbFailures++;
+        printf("FAIL %s:%d: %s\n", file, line, text);
+    }
+}
+
+void printHelp(char *argv[])
+{
+    printf("How to : %s <image_file> <file>...\n", argv[0]);
+    printf("With   : image_file : PFS image, modified by the tests.\n");
+    printf("         file       : Files added to the image with pfsadd, in the same order.\n");
+}
+
+// Reads a whole host file, returns NULL if it can't be read.
+static uint8_t* loadFile(const char *path, uint32_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    rewind(file);
+
+    uint8_t *content = malloc(*size + 1);
+    if (fread(content, 1, *size, file) != *size)
+    {
+        free(content);
+        content = NULL;
+    }
+    fclose(file);
+    return content;
+}
+
+// Counts the data blocks marked as used in the bitmap of the image.
+static uint32_t usedBlocks()
+{
+    Superblock *sb = (Superblock*)disk_sector(0);
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < sb->nbDataBlocks; i++)
+    {
+        uint8_t *sector = disk_sector(sb->sectorsPerBlock + i / (8 * SECTOR_SIZE));
+        used += (sector[(i / 8) % SECTOR_SIZE] >> (7 - i % 8)) & 1;
+    }
+    return used;
+}
+
+static uint32_t countFiles()
+{
+    char name[32];
+    uint32_t count = 0;
+    file_iterator_t it = file_iterator();
+    while (file_next(name, &it))
+    {
+        count++;
+    }
+    return count;
+}
+
+static void testString()
+{
+    char buffer[64];
+
+    CHECK(memset(buffer, 'x', 8) == buffer);
+    CHECK(buffer[0] == 'x' && buffer[7] == 'x');
+
+    // Overlapping copies toward higher addresses are supported (copy from the end)
+    strncpy(buffer, "abcdef", sizeof(buffer));
+    CHECK(memcpy(buffer + 1, buffer, 5) == buffer + 1);
+    CHECK(memcmp(buffer, "aabcde", 6) == 0);
+
+    CHECK(strlen("") == 0);
+    CHECK(strlen("kernel") == 6);
+
+    CHECK(strncmp("abc", "abd", 3) == -1);
+    CHECK(strncmp("abd", "abc", 3) == 1);
+    CHECK(strncmp("abc", "abd", 2) == 0);
+    CHECK(strncmp("abc", "abc", 32) == 0);
+
+    // strcmp returns 1 for equal strings, unlike the standard function
+    CHECK(strcmp("shell", "shell") == 1);
+    CHECK(strcmp("shell", "shelL") == 0);
+    CHECK(strcmp("shell", "shel") == 0);
+
+    // strncpy pads with zeros and doesn't terminate truncated strings
+    memset(buffer, 'x', sizeof(buffer));
+    strncpy(buffer, "ab", 4);
+    CHECK(memcmp(buffer, "ab\0\0x", 5) == 0);
+    strncpy(buffer, "abcdef", 4);
+    CHECK(memcmp(buffer, "abcdx", 5) == 0);
+
+    CHECK(atoi("0") == 0);
+    CHECK(atoi("1337") == 1337);
+    CHECK(atoi("-42") == -42);
+
+    CHECK(memcmp(itoa(0, buffer, 10), "0", 2) == 0);
+    CHECK(memcmp(itoa(-1337, buffer, 10), "-1337", 6) == 0);
+    CHECK(memcmp(itoa(0xAB42, buffer, 16), "AB42", 5) == 0);
+    CHECK(memcmp(itoa(5, buffer, 2), "101", 4) == 0);
+    CHECK(itoa(5, buffer, 37)[0] == '\0');
+
+    CHECK(memcmp(utoa(0, buffer, 10), "0", 2) == 0);
+    CHECK(memcmp(utoa(0xFFFFFFFF, buffer, 16), "FFFFFFFF", 9) == 0);
+    CHECK(memcmp(utoa(4294967295u, buffer, 10), "4294967295", 11) == 0);
+    CHECK(memcmp(utoa(8, buffer, 8), "10", 3) == 0);
+
+    char words[3][8];
+    char line[] = "ls -l dir";
+    split(line, ' ', (char*)words, 3, 8);
+    CHECK(memcmp(words[0], "ls", 3) == 0);
+    CHECK(memcmp(words[1], "-l", 3) == 0);
+    CHECK(memcmp(words[2], "dir", 4) == 0);
+}
+
+static void testFileSystem(int nbFiles, char *files[])
+{
+    char name[32];
+    uint32_t size;
+    stat_t stat;
+
+    superblock_init();
+
+    // Files are listed in the order they were added
+    file_iterator_t it = file_iterator();
+    int count = 0;
+    while (file_next(name, &it))
+    {
+        CHECK(count < nbFiles && strncmp(name, files[count], 32) == 0);
+        count++;
+    }
+    CHECK(count == nbFiles);
+    CHECK(!it.boundToFile);
+
+    // Content of each file
+    for (int i = 0; i < nbFiles; i++)
+    {
+        uint8_t *expected = loadFile(files[i], &size);
+        if (expected == NULL)
+        {
+            printf("Error: Couldn't read the file '%s'.\n", files[i]);
+            exit(1);
+        }
+
+        CHECK(file_exists(files[i]) == 1);
+        CHECK(file_stat(files[i], &stat) == 0);
+        CHECK(stat.size == size);
+
+        // The byte after the file must not be overwritten
+        uint8_t *content = malloc(size + 1);
+        memset(content, CANARY, size + 1);
+        CHECK(file_read(files[i], content) == 0);
+        CHECK(memcmp(content, expected, size) == 0);
+        CHECK(content[size] == CANARY);
+
+        it = find_file(files[i]);
+        CHECK(it.boundToFile);
+        CHECK((int)it.index == i);
+
+        // Partial reads crossing sectors and blocks, truncated at the end of the file
+        uint32_t offsets[] = { 0, 1, SECTOR_SIZE - 1, SECTOR_SIZE, 3 * SECTOR_SIZE + 7, size / 2, size };
+        for (uint32_t k = 0; k < sizeof(offsets) / sizeof(offsets[0]); k++)
+        {
+            uint32_t offset = offsets[k] < size ? offsets[k] : size;
+            uint32_t count = 4096 < size - offset ? 4096 : size - offset;
+            memset(content, CANARY, size + 1);
+            CHECK(file_read_at(&it, content, offset, 4096) == (int)count);
+            CHECK(memcmp(content, expected + offset, count) == 0);
+            CHECK(content[count] == CANARY);
+        }
+
+        free(content);
+        free(expected);
+    }
+
+    // Missing files and prefixes of existing names
+    strncpy(name, files[0], sizeof(name));
+    name[strlen(name) - 1] = '\0';
+    CHECK(file_exists(name) == 0);
+    CHECK(file_exists("missing") == 0);
+    CHECK(file_stat("missing", &stat) == -1);
+    CHECK(file_read("missing", NULL) == -1);
+    CHECK(file_remove("missing") == -1);
+    it = find_file("missing");
+    CHECK(file_read_at(&it, NULL, 0, 1) == -1);
+
+    // Removing a file frees its blocks and keeps the other files intact
+    uint32_t blockSize = ((Superblock*)disk_sector(0))->sectorsPerBlock * SECTOR_SIZE;
+    uint32_t usedBefore = usedBlocks();
+    file_stat(files[0], &stat);
+
+    CHECK(file_remove(files[0]) == 0);
+    CHECK(file_exists(files[0]) == 0);
+    CHECK(file_remove(files[0]) == -1);
+    CHECK(countFiles() == (uint32_t)nbFiles - 1);
+    CHECK(usedBlocks() == usedBefore - (stat.size + blockSize - 1) / blockSize);
+
+    for (int i = 1; i < nbFiles; i++)
+    {
+        uint8_t *expected = loadFile(files[i], &size);
+        uint8_t *content = malloc(size);
+        CHECK(file_read(files[i], content) == 0);
+        CHECK(memcmp(content, expected, size) == 0);
+        free(content);
+        free(expected);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Check number of arguments
+    if (argc < 3)
+    {
+        printf("Error: Not enough arguments.\n");
+        printHelp(argv);
+        return 1;
+    }
+    if (disk_open(argv[1]) == -1)
+    {
+        printf("Error: Couldn't open the image file '%s'.\n", argv[1]);
+        printHelp(argv);
+        return 1;
+    }
+
+    testString();
+    testFileSystem(argc - 2, argv + 2);
+    disk_close();
+
+    printf("%d checks, %d failures\n", nbChecks, nbFailures);
+    return nbFailures > 0;
+}
@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file benchcmp.c
+/// \brief Source of the benchcmp program.
+///
+/// benchcmp compares the results of the kernel benchmarks ("make bench") with a baseline
+/// and reports the benchmarks whose cost per operation increased by more than a given
+/// threshold. The exit status is 1 if at least one regression was found.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_SIZE       256
+#define NAME_SIZE       64
+#define MAX_RESULTS     128
+#define DEFAULT_THRESHOLD 10.0
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct Result
+/// \brief The result of one benchmark.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    char            name[NAME_SIZE];
+    unsigned int    iterations;
+    unsigned int    cycles;             ///< Cycles per operation
+} Result;
+
+void printHelp(char *argv[])
+{
+    printf("How to : %s <baseline_file> <results_file> [<threshold>]\n", argv[0]);
+    printf("With   : baseline_file : Reference results (bench/baseline.txt).\n");
+    printf("         results_file  : Serial output of the benchmark kernel.\n");
+    printf("         threshold     : Tolerated slowdown in percent (default: %.0f).\n",
+           DEFAULT_THRESHOLD);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int loadResults(const char *path, Result *results)
+/// \brief Reads the "BENCH <name> <iterations> <cycles/op>" lines of a file.
+/// \return The number of results or -1 if the file can't be read.
+//////////////////////////////////////////////////////////////////////////////////////////
+static int loadResults(const char *path, Result *results)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    char line[LINE_SIZE];
+    int nbResults = 0;
+    while (nbResults < MAX_RESULTS && fgets(line, sizeof(line), file) != NULL)
+    {
+        Result *result = &results[nbResults];
+        if (sscanf(line, "BENCH %63s %u %u", result->name, &result->iterations,
+                   &result->cycles) == 3)
+        {
+            nbResults++;
+        }
+    }
+    fclose(file);
+    return nbResults;
+}
+
+int main(int argc, char *argv[])
+{
+    // Check number of arguments
+    if (argc < 3)
+    {
+        printf("Error: Not enough arguments.\n");
+        printHelp(argv);
+        return 1;
+    }
+
+    double threshold = argc > 3 ? atof(argv[3]) : DEFAULT_THRESHOLD;
+    static Result baseline[MAX_RESULTS];
+    static Result current[MAX_RESULTS];
+
+    int nbCurrent = loadResults(argv[2], current);
+    if (nbCurrent <= 0)
+    {
+        printf("Error: No benchmark result found in '%s'.\n", argv[2]);
+        return 1;
+    }
+
+    int nbBaseline = loadResults(argv[1], baseline);
+    if (nbBaseline == -1)
+    {
+        // Nothing to compare with: print the results and let the user record them
+        for (int i = 0; i < nbCurrent; i++)
+        {
+            printf("%-28s %12u cycles/op\n", current[i].name, current[i].cycles);
+        }
+        printf("No baseline '%s', run 'make bench-baseline' to record one.\n", argv[1]);
+        return 0;
+    }
+
+    int nbRegressions = 0;
+    printf("%-28s %12s %12s %9s\n", "benchmark", "baseline", "current", "change");
+    for (int i = 0; i < nbCurrent; i++)
+    {
+        Result *reference = NULL;
+        for (int j = 0; j < nbBaseline && reference == NULL; j++)
+        {
+            if (strcmp(baseline[j].name, current[i].name) == 0)
+            {
+                reference = &baseline[j];
+            }
+        }
+
+        if (reference == NULL || reference->cycles == 0)
+        {
+            printf("%-28s %12s %12u %9s\n", current[i].name, "-", current[i].cycles, "new");
+            continue;
+        }
+
+        double change = 100.0 * ((double)current[i].cycles - reference->cycles)
+                        / reference->cycles;
+        int regression = change > threshold;
+        nbRegressions += regression;
+        printf("%-28s %12u %12u %+8.1f%%%s\n", current[i].name, reference->cycles,
+               current[i].cycles, change, regression ? "  REGRESSION" : "");
+    }
+
+    if (nbRegressions > 0)
+    {
+        printf("%d benchmark(s) slower than the baseline by more than %.1f%%.\n",
+               nbRegressions, threshold);
+        return 1;
+    }
+    return 0;
+}
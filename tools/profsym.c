@@ -0,0 +1,390 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file profsym.c
+/// \brief Source of the profsym program.
+///
+/// profsym symbolizes the samples dumped by the kernel profiler ("prof dump" in the
+/// shell) and prints either a flat profile or folded stacks that can be fed to
+/// flamegraph.pl. Kernel addresses are resolved with the symbol table of kernel.elf and
+/// user addresses with the <name>.elf companion of each flat user binary.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#define _POSIX_C_SOURCE 200809L  // strdup
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_SIZE       1024
+#define MAX_DEPTH       32
+#define MAX_USER_FILES  32
+#define NAME_SIZE       32
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct Symbol
+/// \brief A function symbol of an executable.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    uint32_t    address;
+    char       *name;
+} Symbol;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct SymbolTable
+/// \brief Symbols of an executable, sorted by address.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    char        name[NAME_SIZE];    ///< Name of the task (or "kernel")
+    Symbol     *symbols;
+    uint32_t    nbSymbols;
+} SymbolTable;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct Entry
+/// \brief A counter associated to a string (symbol name or folded stack).
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    char       *key;
+    uint32_t    self;
+    uint32_t    total;
+} Entry;
+
+typedef struct
+{
+    Entry      *entries;
+    uint32_t    nbEntries;
+    uint32_t    capacity;
+} Counters;
+
+static SymbolTable kernelTable;
+static SymbolTable userTables[MAX_USER_FILES];
+static uint32_t nbUserTables = 0;
+static const char *userDir = ".";
+
+void printHelp(char *argv[])
+{
+    printf("How to : %s <flat|folded> <samples_file> <kernel_elf> [<user_dir>]\n", argv[0]);
+    printf("With   : flat|folded  : Output a flat profile or folded stacks for flamegraph.pl.\n");
+    printf("         samples_file : Output of the 'prof dump' shell command.\n");
+    printf("         kernel_elf   : Path to kernel.elf.\n");
+    printf("         user_dir     : Directory containing the <program>.elf files (default: .).\n");
+}
+
+static int compareSymbols(const void *a, const void *b)
+{
+    uint32_t x = ((const Symbol*)a)->address;
+    uint32_t y = ((const Symbol*)b)->address;
+    return (x > y) - (x < y);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn int loadSymbols(SymbolTable *table, const char *path)
+/// \brief Loads the function symbols of a 32-bit ELF file.
+/// \return 0 on success or -1 if the file can't be read or isn't an ELF32 file.
+//////////////////////////////////////////////////////////////////////////////////////////
+static int loadSymbols(SymbolTable *table, const char *path)
+{
+    table->symbols = NULL;
+    table->nbSymbols = 0;
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    uint8_t *image = malloc(size);
+    if (fread(image, 1, size, file) != (size_t)size)
+    {
+        fclose(file);
+        free(image);
+        return -1;
+    }
+    fclose(file);
+
+    Elf32_Ehdr *header = (Elf32_Ehdr*)image;
+    if (size < (long)sizeof(Elf32_Ehdr) || memcmp(header->e_ident, ELFMAG, SELFMAG) != 0
+        || header->e_ident[EI_CLASS] != ELFCLASS32)
+    {
+        free(image);
+        return -1;
+    }
+
+    Elf32_Shdr *sections = (Elf32_Shdr*)(image + header->e_shoff);
+    for (int i = 0; i < header->e_shnum; i++)
+    {
+        if (sections[i].sh_type != SHT_SYMTAB)
+        {
+            continue;
+        }
+
+        Elf32_Sym *symbols = (Elf32_Sym*)(image + sections[i].sh_offset);
+        char *strings = (char*)(image + sections[sections[i].sh_link].sh_offset);
+        uint32_t count = sections[i].sh_size / sizeof(Elf32_Sym);
+
+        table->symbols = malloc(count * sizeof(Symbol));
+        for (uint32_t j = 0; j < count; j++)
+        {
+            int type = ELF32_ST_TYPE(symbols[j].st_info);
+            char *name = strings + symbols[j].st_name;
+
+            // Assembly labels have no type, skip local labels and section symbols
+            if ((type != STT_FUNC && type != STT_NOTYPE) || symbols[j].st_shndx == SHN_UNDEF
+                || name[0] == '\0' || name[0] == '.')
+            {
+                continue;
+            }
+            table->symbols[table->nbSymbols].address = symbols[j].st_value;
+            table->symbols[table->nbSymbols].name = strdup(name);
+            table->nbSymbols++;
+        }
+        break;
+    }
+    free(image);
+
+    qsort(table->symbols, table->nbSymbols, sizeof(Symbol), compareSymbols);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \fn const char* resolve(SymbolTable *table, uint32_t address)
+/// \brief Returns the name of the function containing the address.
+///
+/// The returned string is only valid until the next call.
+//////////////////////////////////////////////////////////////////////////////////////////
+static const char* resolve(SymbolTable *table, uint32_t address)
+{
+    static char unknown[32];
+
+    // Binary search of the last symbol whose address is <= address
+    int32_t low = 0;
+    int32_t high = (int32_t)table->nbSymbols - 1;
+    int32_t found = -1;
+    while (low <= high)
+    {
+        int32_t middle = (low + high) / 2;
+        if (table->symbols[middle].address <= address)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    if (found == -1)
+    {
+        snprintf(unknown, sizeof(unknown), "0x%x", address);
+        return unknown;
+    }
+    return table->symbols[found].name;
+}
+
+// Returns the symbol table of a user program, loading it on first use.
+static SymbolTable* userTable(const char *name)
+{
+    for (uint32_t i = 0; i < nbUserTables; i++)
+    {
+        if (strcmp(userTables[i].name, name) == 0)
+        {
+            return &userTables[i];
+        }
+    }
+    if (nbUserTables == MAX_USER_FILES)
+    {
+        fprintf(stderr, "Error: Too many user programs.\n");
+        exit(1);
+    }
+
+    SymbolTable *table = &userTables[nbUserTables++];
+    char path[LINE_SIZE];
+    snprintf(table->name, NAME_SIZE, "%s", name);
+    snprintf(path, sizeof(path), "%s/%s.elf", userDir, name);
+    if (loadSymbols(table, path) == -1)
+    {
+        fprintf(stderr, "Warning: Couldn't load the symbols of '%s'.\n", path);
+    }
+    return table;
+}
+
+// Returns the counter associated to key, creating it if needed.
+static Entry* counter(Counters *counters, const char *key)
+{
+    for (uint32_t i = 0; i < counters->nbEntries; i++)
+    {
+        if (strcmp(counters->entries[i].key, key) == 0)
+        {
+            return &counters->entries[i];
+        }
+    }
+    if (counters->nbEntries == counters->capacity)
+    {
+        counters->capacity = counters->capacity ? counters->capacity * 2 : 64;
+        counters->entries = realloc(counters->entries, counters->capacity * sizeof(Entry));
+    }
+    Entry *entry = &counters->entries[counters->nbEntries++];
+    entry->key = strdup(key);
+    entry->self = entry->total = 0;
+    return entry;
+}
+
+static int compareBySelf(const void *a, const void *b)
+{
+    const Entry *x = a;
+    const Entry *y = b;
+    if (x->self != y->self)
+    {
+        return x->self < y->self ? 1 : -1;
+    }
+    return (x->total < y->total) - (x->total > y->total);
+}
+
+static int compareByKey(const void *a, const void *b)
+{
+    return strcmp(((const Entry*)a)->key, ((const Entry*)b)->key);
+}
+
+int main(int argc, char *argv[])
+{
+    // Check number of arguments
+    if (argc < 4)
+    {
+        printf("Error: Not enough arguments.\n");
+        printHelp(argv);
+        return 1;
+    }
+
+    int folded = strcmp(argv[1], "folded") == 0;
+    if (!folded && strcmp(argv[1], "flat") != 0)
+    {
+        printf("Error: Unknown output '%s'.\n", argv[1]);
+        printHelp(argv);
+        return 1;
+    }
+
+    FILE *samplesFile = fopen(argv[2], "r");
+    if (samplesFile == NULL)
+    {
+        printf("Error: Couldn't read the samples file '%s'.\n", argv[2]);
+        printHelp(argv);
+        return 1;
+    }
+    if (loadSymbols(&kernelTable, argv[3]) == -1)
+    {
+        printf("Error: Couldn't read the symbols of '%s'.\n", argv[3]);
+        printHelp(argv);
+        return 1;
+    }
+    if (argc > 4)
+    {
+        userDir = argv[4];
+    }
+
+    Counters counters = { NULL, 0, 0 };
+    uint32_t nbSamples = 0;
+    char line[LINE_SIZE];
+
+    while (fgets(line, sizeof(line), samplesFile) != NULL)
+    {
+        // Only sample lines are of interest, the VGA/serial output may contain others
+        char name[NAME_SIZE];
+        int task, offset;
+        uint32_t cs;
+        if (strncmp(line, "S ", 2) != 0
+            || sscanf(line, "S %31s %d %x%n", name, &task, &cs, &offset) != 3)
+        {
+            continue;
+        }
+
+        // Leaf first: the interrupted eip followed by the return addresses
+        uint32_t addresses[MAX_DEPTH + 1];
+        int depth = 0;
+        char *cursor = line + offset;
+        int consumed;
+        while (depth <= MAX_DEPTH && sscanf(cursor, "%x%n", &addresses[depth], &consumed) == 1)
+        {
+            // Return addresses point after the call instruction
+            if (depth > 0)
+            {
+                addresses[depth]--;
+            }
+            cursor += consumed;
+            depth++;
+        }
+        if (depth == 0)
+        {
+            continue;
+        }
+        nbSamples++;
+
+        int kernelMode = (cs & 3) == 0;
+        SymbolTable *table = kernelMode ? &kernelTable : userTable(name);
+        const char *suffix = kernelMode ? "_[k]" : "";
+
+        if (folded)
+        {
+            char stack[LINE_SIZE * 4];
+            int length = snprintf(stack, sizeof(stack), "%s", name);
+            for (int i = depth - 1; i >= 0 && length < (int)sizeof(stack); i--)
+            {
+                length += snprintf(stack + length, sizeof(stack) - length, ";%s%s",
+                                   resolve(table, addresses[i]), suffix);
+            }
+            counter(&counters, stack)->self++;
+        }
+        else
+        {
+            char symbol[LINE_SIZE];
+            snprintf(symbol, sizeof(symbol), "%s%s", resolve(table, addresses[0]), suffix);
+            counter(&counters, symbol)->self++;
+
+            // Inclusive counts: each function is counted once per sample
+            char seen[MAX_DEPTH + 1][LINE_SIZE];
+            int nbSeen = 0;
+            for (int i = 0; i < depth; i++)
+            {
+                snprintf(symbol, sizeof(symbol), "%s%s", resolve(table, addresses[i]), suffix);
+                int j = 0;
+                for (; j < nbSeen && strcmp(seen[j], symbol) != 0; j++);
+                if (j == nbSeen)
+                {
+                    strcpy(seen[nbSeen++], symbol);
+                    counter(&counters, symbol)->total++;
+                }
+            }
+        }
+    }
+    fclose(samplesFile);
+
+    if (folded)
+    {
+        qsort(counters.entries, counters.nbEntries, sizeof(Entry), compareByKey);
+        for (uint32_t i = 0; i < counters.nbEntries; i++)
+        {
+            printf("%s %u\n", counters.entries[i].key, counters.entries[i].self);
+        }
+    }
+    else
+    {
+        qsort(counters.entries, counters.nbEntries, sizeof(Entry), compareBySelf);
+        printf("%u samples\n", nbSamples);
+        printf("  self%%    self   total  function\n");
+        for (uint32_t i = 0; i < counters.nbEntries; i++)
+        {
+            Entry *entry = &counters.entries[i];
+            printf("%6.2f%% %7u %7u  %s\n", nbSamples ? 100.0 * entry->self / nbSamples : 0.0,
+                   entry->self, entry->total, entry->key);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file trace2json.c
+/// \brief Source of the trace2json program.
+///
+/// trace2json converts the events dumped by the kernel ("trace" in the shell, kernel
+/// built with TRACE=1) into the Chrome trace event format, which can be opened with
+/// chrome://tracing or https://ui.perfetto.dev.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LINE_SIZE 256
+#define MAX_TASKS 256
+
+void printHelp(char *argv[])
+{
+    printf("How to : %s <trace_file> [<json_file>]\n", argv[0]);
+    printf("With   : trace_file : Serial output containing the 'trace' dump.\n");
+    printf("         json_file  : Path to the JSON file to create (default: standard output).\n");
+}
+
+// Returns the phase of an event given its type name : B(egin), E(nd) or i(nstant).
+static char phase(const char *type)
+{
+    const char *suffix = strrchr(type, '_');
+    if (suffix != NULL && (strcmp(suffix, "_entry") == 0 || strcmp(suffix, "_begin") == 0))
+    {
+        return 'B';
+    }
+    if (suffix != NULL && (strcmp(suffix, "_exit") == 0 || strcmp(suffix, "_end") == 0))
+    {
+        return 'E';
+    }
+    return 'i';
+}
+
+int main(int argc, char *argv[])
+{
+    // Check number of arguments
+    if (argc < 2)
+    {
+        printf("Error: Not enough arguments.\n");
+        printHelp(argv);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "r");
+    if (in == NULL)
+    {
+        printf("Error: Couldn't read the trace file '%s'.\n", argv[1]);
+        printHelp(argv);
+        return 1;
+    }
+    FILE *out = stdout;
+    if (argc > 2 && (out = fopen(argv[2], "w")) == NULL)
+    {
+        printf("Error: Couldn't create the file '%s'.\n", argv[2]);
+        printHelp(argv);
+        return 1;
+    }
+
+    char line[LINE_SIZE];
+    uint32_t tscKhz = 0;
+    uint64_t firstTsc = 0;
+    int nbEvents = 0;
+    int seenTasks[MAX_TASKS + 1] = { 0 };
+
+    fprintf(out, "{\"traceEvents\":[\n");
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        unsigned int cpus, khz;
+        if (sscanf(line, "# trace cpus=%u tsc_khz=%u", &cpus, &khz) == 2)
+        {
+            tscKhz = khz;
+            continue;
+        }
+
+        int cpu, task;
+        unsigned int high, low, arg;
+        char type[64];
+        if (sscanf(line, "T %d %x %x %63s %d %u", &cpu, &high, &low, type, &task, &arg) != 6)
+        {
+            continue;
+        }
+        if (tscKhz == 0)
+        {
+            fprintf(stderr, "Error: Event found before the '# trace' header.\n");
+            return 1;
+        }
+
+        uint64_t tsc = ((uint64_t)high << 32) | low;
+        if (nbEvents == 0)
+        {
+            firstTsc = tsc;
+        }
+        double timestamp = (double)(tsc - firstTsc) * 1000.0 / tscKhz;  // [us]
+
+        // The kernel (task -1) gets thread id 0
+        int tid = task + 1;
+        if (tid >= 0 && tid <= MAX_TASKS && !seenTasks[tid])
+        {
+            char threadName[32] = "kernel";
+            if (tid > 0)
+            {
+                snprintf(threadName, sizeof(threadName), "task %d", task);
+            }
+            seenTasks[tid] = 1;
+            fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                    "\"args\":{\"name\":\"%s\"}}", nbEvents ? ",\n" : "", cpu, tid, threadName);
+            nbEvents++;
+        }
+
+        // Begin/end pairs share the name without their suffix
+        char name[64];
+        char ph = phase(type);
+        strcpy(name, type);
+        if (ph != 'i')
+        {
+            *strrchr(name, '_') = '\0';
+        }
+        if (strcmp(name, "irq") == 0 || strcmp(name, "syscall") == 0)
+        {
+            snprintf(name + strlen(name), sizeof(name) - strlen(name), " %u", arg);
+        }
+
+        fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,"
+                "%s\"args\":{\"arg\":%u}}", nbEvents ? ",\n" : "", name, ph, timestamp, cpu, tid,
+                ph == 'i' ? "\"s\":\"t\"," : "", arg);
+        nbEvents++;
+    }
+    fprintf(out, "\n]}\n");
+
+    fclose(in);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -1,11 +1,29 @@
 extern main
+extern _text_end
+extern _end
+extern _stack_size
+extern _memory_size
 global entrypoint
 global exit
 
+APP_MAGIC   equ 0x31505041  ; "APP1"
+
 section .entrypoint
 align 4
 
 entrypoint:
+    jmp     short start
+
+; Header read by the kernel (see kernel/image.h)
+align 4
+header:
+    dd      APP_MAGIC
+    dd      _text_end       ; end of the code and read-only data, shared by the instances
+    dd      _end            ; end of the bss, start of the heap
+    dd      _stack_size     ; size of the stack, at the top of the task memory
+    dd      _memory_size    ; size of the task memory (code, data, heap and stack)
+
+start:
     mov     [stack_ptr],esp
     call    main
 exit:
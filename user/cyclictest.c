@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file cyclictest.c
+/// \brief Measures the wakeup jitter of a periodic task.
+///
+/// Sleeps one timer period after the other, like cyclictest, and measures each period
+/// with the TSC. The kernel wakes the task at a timer tick, so the periods only differ
+/// from INTERVAL_MS by the latency of the wakeups: the IRQ, the return from hlt and from
+/// the system call. The deviations are printed as a histogram, followed by the
+/// measures of the kernel when it is built with LATENCY=1.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ulibc.h"
+
+#define LOOPS           500
+#define INTERVAL_MS     10      // One tick at 100 Hz
+#define NB_BUCKETS      12      // 0, then powers of two of microseconds up to 1024
+#define BAR_WIDTH       50
+
+// Low 32 bits of the time stamp counter, enough for the durations measured here.
+static uint cycles()
+{
+    uint low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return low;
+}
+
+// Index of the histogram bucket of a deviation: 0 for 0 us, k for [2^(k-1), 2^k[ us.
+static uint bucket(uint us)
+{
+    uint k = 0;
+    while (us != 0 && k < NB_BUCKETS - 1)
+    {
+        us >>= 1;
+        k++;
+    }
+    return k;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void main()
+{
+    uint cycles_per_us = get_tsc_khz() / 1000;
+    if (cycles_per_us == 0)
+    {
+        printf("# cyclictest: unknown TSC frequency\n");
+        return;
+    }
+
+    uint histogram[NB_BUCKETS] = { 0 };
+    uint min_us = 0xFFFFFFFF, max_us = 0, total_us = 0, max_jitter_us = 0;
+    uint expected_us = INTERVAL_MS * 1000;
+
+    latency_stats(true);
+
+    // The first sleep ends on a tick, the next ones last a whole period
+    sleep(INTERVAL_MS);
+    uint last = cycles();
+    for (int i = 0; i < LOOPS; i++)
+    {
+        sleep(INTERVAL_MS);
+        uint now = cycles();
+        uint period_us = (now - last) / cycles_per_us;
+        last = now;
+
+        uint jitter_us = period_us > expected_us ? period_us - expected_us : expected_us - period_us;
+        histogram[bucket(jitter_us)]++;
+        total_us += period_us;
+        if (period_us < min_us)
+        {
+            min_us = period_us;
+        }
+        if (period_us > max_us)
+        {
+            max_us = period_us;
+        }
+        if (jitter_us > max_jitter_us)
+        {
+            max_jitter_us = jitter_us;
+        }
+    }
+
+    printf("%u periods of %u us: min %u, avg %u, max %u us, max jitter %u us\n", LOOPS,
+           expected_us, min_us, total_us / LOOPS, max_us, max_jitter_us);
+
+    uint highest = 0;
+    for (uint k = 0; k < NB_BUCKETS; k++)
+    {
+        if (histogram[k] > highest)
+        {
+            highest = histogram[k];
+        }
+    }
+
+    printf("jitter (us)\tcount\n");
+    for (uint k = 0; k < NB_BUCKETS; k++)
+    {
+        if (k == 0)
+        {
+            printf("0\t\t%u\t", histogram[k]);
+        }
+        else if (k == NB_BUCKETS - 1)
+        {
+            printf(">= %u\t\t%u\t", 1 << (k - 1), histogram[k]);
+        }
+        else
+        {
+            printf("%u - %u\t\t%u\t", 1 << (k - 1), (1 << k) - 1, histogram[k]);
+        }
+        for (uint i = 0; i < histogram[k] * BAR_WIDTH / highest; i++)
+        {
+            putc('#');
+        }
+        putc('\n');
+    }
+
+    latency_stats(false);
+}
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file forkbench.c
+/// \brief Benchmark of the fork() system call.
+///
+/// Measures the latency of fork() (the child exits immediately) while the task has
+/// more and more memory to share: the heap is grown and written before each series.
+/// The results are printed as "BENCH <name> <iterations> <cycles/op>" lines, like the
+/// kernel benchmarks. The launch of the empty program "app" is given for reference.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ulibc.h"
+
+#define ITERATIONS  32
+#define PAGE_SIZE   4096
+
+static const uint heap_sizes_kb[] = { 0, 64, 256, 512 };
+
+// Low 32 bits of the time stamp counter, enough for the durations measured here.
+static uint cycles()
+{
+    uint low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return low;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void main()
+{
+    for (uint i = 0; i < sizeof(heap_sizes_kb) / sizeof(heap_sizes_kb[0]); i++)
+    {
+        uint size = heap_sizes_kb[i] * 1024;
+        uint8_t *heap = NULL;
+        if (size > 0)
+        {
+            heap = malloc(size);
+            if (heap == NULL)
+            {
+                printf("# fork: no memory for %u KB\n", heap_sizes_kb[i]);
+                break;
+            }
+        }
+
+        uint total = 0;
+        for (int j = 0; j < ITERATIONS; j++)
+        {
+            // Every page is private again before each fork
+            for (uint offset = 0; offset < size; offset += PAGE_SIZE)
+            {
+                heap[offset] = j;
+            }
+
+            uint start = cycles();
+            if (fork() == 0)
+            {
+                exit();
+            }
+            total += cycles() - start;
+        }
+        printf("BENCH fork_%uk %u %u\n", heap_sizes_kb[i], ITERATIONS, total / ITERATIONS);
+        free(heap);
+    }
+
+    uint start = cycles();
+    for (int j = 0; j < ITERATIONS; j++)
+    {
+        exec("app");
+    }
+    printf("BENCH exec_app %u %u\n", ITERATIONS, (cycles() - start) / ITERATIONS);
+}
@@ -0,0 +1,219 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file malloc.c
+/// \brief Implementation of the heap allocator of the ulibc (malloc/free).
+///
+/// The heap is a single arena grown with sbrk(). Small blocks (up to 2048 bytes) are
+/// sorted in power of two size classes: a freed block goes to the free list of its
+/// class and malloc() takes the head of the list, or bumps a pointer in the current
+/// chunk of the arena when the list is empty. Large blocks are rounded to pages and
+/// get their own sbrk() region, they are reused first-fit and given back to the kernel
+/// when they are at the top of the heap.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ulibc.h"
+
+#define MALLOC_ALIGN        8
+#define MALLOC_MIN_CLASS    16
+#define MALLOC_MAX_CLASS    2048
+#define MALLOC_NB_CLASSES   8       // 16, 32, ..., 2048
+#define MALLOC_CHUNK_SIZE   0x4000  // Arena growth step of the small blocks
+#define MALLOC_PAGE_SIZE    4096    // Rounding of the large blocks
+
+// Header of every block, the payload follows it
+typedef struct block_st {
+    uint32_t size;          // Size of the block, header included
+    uint32_t requested;     // Bytes requested by the user, 0 if the block is free
+} block_t;
+
+// A free block stores the link to the next free block in its payload
+typedef struct free_block_st {
+    block_t header;
+    struct free_block_st *next;
+} free_block_t;
+
+//////////////////////////////////// STATIC GLOBALS //////////////////////////////////////
+
+static free_block_t *classes[MALLOC_NB_CLASSES];
+static free_block_t *large_blocks;
+
+// Unused part of the current chunk of small blocks
+static uint8_t *bump;
+static uint8_t *bump_end;
+
+static malloc_stats_t stats;
+
+/////////////////////////////////// STATIC FUNCTIONS /////////////////////////////////////
+
+// Returns the size class of a small request.
+static int class_index(uint32_t size)
+{
+    int index = 0;
+    while ((uint32_t)(MALLOC_MIN_CLASS << index) < size)
+    {
+        index++;
+    }
+    return index;
+}
+
+// Grows the heap by size bytes (plus alignment), returns NULL if the kernel refuses.
+static uint8_t* heap_grow(uint32_t size)
+{
+    uint32_t top = (uint32_t)sbrk(0);
+    uint32_t padding = (MALLOC_ALIGN - top % MALLOC_ALIGN) % MALLOC_ALIGN;
+
+    if (top == (uint32_t)-1 || sbrk(padding + size) == (void*)-1)
+    {
+        return NULL;
+    }
+    stats.heap_size += padding + size;
+    return (uint8_t*)(top + padding);
+}
+
+// Takes a small block from the current chunk, starting a new chunk if needed.
+static block_t* bump_alloc(uint32_t size)
+{
+    if (bump == NULL || (uint32_t)(bump_end - bump) < size)
+    {
+        uint8_t *chunk = heap_grow(MALLOC_CHUNK_SIZE);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+        // The end of the previous chunk is lost unless the new one follows it
+        if (chunk != bump_end)
+        {
+            bump = chunk;
+        }
+        bump_end = chunk + MALLOC_CHUNK_SIZE;
+    }
+
+    block_t *block = (block_t*)bump;
+    block->size = size;
+    bump += size;
+    return block;
+}
+
+// Takes a large block from the free list (first fit) or from a new heap region.
+static block_t* large_alloc(uint32_t size)
+{
+    for (free_block_t **link = &large_blocks; *link != NULL; link = &(*link)->next)
+    {
+        free_block_t *block = *link;
+        if (block->header.size >= size)
+        {
+            *link = block->next;
+            stats.free -= block->header.size;
+            return &block->header;
+        }
+    }
+
+    block_t *block = (block_t*)heap_grow(size);
+    if (block != NULL)
+    {
+        block->size = size;
+    }
+    return block;
+}
+
+// Gives the free large blocks at the top of the heap back to the kernel.
+static void large_trim()
+{
+    bool trimmed = true;
+    while (trimmed)
+    {
+        trimmed = false;
+        uint8_t *top = sbrk(0);
+        for (free_block_t **link = &large_blocks; *link != NULL; link = &(*link)->next)
+        {
+            free_block_t *block = *link;
+            if ((uint8_t*)block + block->header.size == top)
+            {
+                *link = block->next;
+                sbrk(-(int)block->header.size);
+                stats.free -= block->header.size;
+                stats.heap_size -= block->header.size;
+                trimmed = true;
+                break;
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void* malloc(uint32_t size)
+{
+    if (size == 0)
+    {
+        return NULL;
+    }
+
+    block_t *block;
+    if (size <= MALLOC_MAX_CLASS)
+    {
+        int index = class_index(size);
+        free_block_t *head = classes[index];
+        if (head != NULL)
+        {
+            classes[index] = head->next;
+            block = &head->header;
+            stats.free -= block->size;
+        }
+        else
+        {
+            block = bump_alloc(sizeof(block_t) + (MALLOC_MIN_CLASS << index));
+        }
+    }
+    else
+    {
+        uint32_t rounded = (sizeof(block_t) + size + MALLOC_PAGE_SIZE - 1) & ~(MALLOC_PAGE_SIZE - 1);
+        block = rounded > size ? large_alloc(rounded) : NULL;
+    }
+
+    if (block == NULL)
+    {
+        stats.nb_failures++;
+        return NULL;
+    }
+
+    block->requested = size;
+    stats.allocated += size;
+    stats.used += block->size;
+    stats.nb_mallocs++;
+    return block + 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void free(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    free_block_t *block = (free_block_t*)((block_t*)ptr - 1);
+    stats.allocated -= block->header.requested;
+    stats.used -= block->header.size;
+    stats.free += block->header.size;
+    stats.nb_frees++;
+    block->header.requested = 0;
+
+    uint32_t payload = block->header.size - sizeof(block_t);
+    if (payload <= MALLOC_MAX_CLASS)
+    {
+        int index = class_index(payload);
+        block->next = classes[index];
+        classes[index] = block;
+    }
+    else
+    {
+        block->next = large_blocks;
+        large_blocks = block;
+        large_trim();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void malloc_get_stats(malloc_stats_t *result)
+{
+    *result = stats;
+}
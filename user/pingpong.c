@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file pingpong.c
+/// \brief Benchmark of the message passing ports.
+///
+/// The program forks a server which replies to each message on a port, then measures
+/// the round trips of small messages, passed in registers, and of messages lending
+/// pages, which are mapped in the server and back instead of being copied. The copy of
+/// the same amount of memory is given for reference. The results are printed as
+/// "BENCH <name> <iterations> <cycles/op>" lines, like the kernel benchmarks, with the
+/// throughput of the lent pages.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ulibc.h"
+
+#define ROUND_TRIPS     1000
+#define PAGE_ITERATIONS 100
+#define PAGE_SIZE       4096
+#define MAX_PAGES       64
+
+static const uint payload_pages[] = { 1, 16, 64 };
+
+// Lent by the client, received by the server. After the executable: its pages can move
+static uint8_t buffer[MAX_PAGES * PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+static uint8_t window[MAX_PAGES * PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+// Low 32 bits of the time stamp counter, enough for the durations measured here.
+static uint cycles()
+{
+    uint low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return low;
+}
+
+// Replies to the messages: data[0] + 1 and the sum of the first byte of each page
+// received, which are sent back. Runs until the client exits.
+static void server(int port)
+{
+    ipc_msg_t msg;
+    while (1)
+    {
+        msg.pages = IPC_PAGES((uint)window, MAX_PAGES);
+        if (port_receive(port, &msg) == -1)
+        {
+            return;
+        }
+
+        uint sum = 0;
+        for (uint i = 0; i < IPC_PAGES_COUNT(msg.pages); i++)
+        {
+            sum += window[i * PAGE_SIZE];
+        }
+        msg.data[0]++;
+        msg.data[1] = sum;
+        port_reply(port, &msg);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void main()
+{
+    int port = port_create();
+    if (port == -1)
+    {
+        printf("# pingpong: no free port\n");
+        return;
+    }
+
+    // The server waits for the first message, fork() returns then
+    int pid = fork();
+    if (pid == 0)
+    {
+        server(port);
+        exit();
+    }
+    if (pid == -1)
+    {
+        printf("# pingpong: fork failed\n");
+        return;
+    }
+
+    ipc_msg_t msg;
+    uint start = cycles();
+    for (uint i = 0; i < ROUND_TRIPS; i++)
+    {
+        msg.data[0] = i;
+        msg.pages = 0;
+        if (port_send(port, &msg) == -1 || msg.data[0] != i + 1)
+        {
+            printf("# pingpong: wrong reply\n");
+            return;
+        }
+    }
+    printf("BENCH ipc_round_trip %u %u\n", ROUND_TRIPS, (cycles() - start) / ROUND_TRIPS);
+
+    uint khz = get_tsc_khz();
+    for (uint i = 0; i < sizeof(payload_pages) / sizeof(payload_pages[0]); i++)
+    {
+        uint count = payload_pages[i];
+        uint size_kb = count * PAGE_SIZE / 1024;
+
+        uint total = 0;
+        for (uint j = 0; j < PAGE_ITERATIONS; j++)
+        {
+            // The pages are mapped again by the reply
+            for (uint k = 0; k < count; k++)
+            {
+                buffer[k * PAGE_SIZE] = j;
+            }
+
+            msg.pages = IPC_PAGES((uint)buffer, count);
+            start = cycles();
+            int result = port_send(port, &msg);
+            total += cycles() - start;
+
+            if (result == -1 || msg.data[1] != count * (j & 0xFF) || IPC_PAGES_COUNT(msg.pages) != count)
+            {
+                printf("# pingpong: wrong reply for %u pages\n", count);
+                return;
+            }
+        }
+        uint per_trip = total / PAGE_ITERATIONS;
+        printf("BENCH ipc_pages_%uk %u %u\n", size_kb, PAGE_ITERATIONS, per_trip);
+
+        // KB per millisecond, about MB/s
+        printf("# ipc_pages_%uk: %u MB/s\n", size_kb, per_trip != 0 ? size_kb * khz / per_trip : 0);
+
+        start = cycles();
+        for (uint j = 0; j < PAGE_ITERATIONS; j++)
+        {
+            memcpy(window, buffer, count * PAGE_SIZE);
+        }
+        printf("BENCH ipc_copy_%uk %u %u\n", size_kb, PAGE_ITERATIONS, (cycles() - start) / PAGE_ITERATIONS);
+    }
+}
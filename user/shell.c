@@ -12,9 +12,40 @@
 #include "ulibc.h"
 
 #define BUFFER_SIZE 512
+#define MAX_COMMANDS 8      // Commandes d'un pipeline
+
+// Aide de chaque commande, affichee par help et en cas d'erreur d'arguments
+#define USAGE_LS      "ls : liste tous les fichiers du systeme de fichiers\n"
+#define USAGE_CAT     "cat <file> : affiche le contenu du fichier file\n"
+#define USAGE_RM      "rm <file> : efface le fichier file\n"
+#define USAGE_RUN     "run <file> : execute le fichier file\n"
+#define USAGE_FORK    "fork : lance une copie du shell, exit y revient\n"
+#define USAGE_TICKS   "ticks : affiche le nombre de ticks courant\n"
+#define USAGE_SLEEP   "sleep <N> : attend pendant N milli-secondes\n"
+#define USAGE_PROF    "prof start|stop|reset|dump : controle le profileur du noyau\n"
+#define USAGE_TRACE   "trace : envoie les evenements traces par le noyau sur le port serie\n"
+#define USAGE_MEM     "mem : affiche l'etat de l'allocateur de memoire physique du noyau\n"
+#define USAGE_LOCKS   "locks [reset] : affiche (ou remet a zero) les statistiques des verrous du noyau\n"
+#define USAGE_IRQ     "irq : affiche les statistiques des interruptions et des traitements differes\n"
+#define USAGE_LATENCY "latency [reset] : affiche (ou remet a zero) les latences des interruptions\n"
+#define USAGE_HEAP    "heap : affiche l'etat du tas (malloc) du shell\n"
+#define USAGE_WC      "<commande> | wc : compte les lignes, les mots et les octets de la sortie de commande\n"
+#define USAGE_GREP    "<commande> | grep <motif> : affiche les lignes de la sortie de commande contenant motif\n"
+#define USAGE_PIPE    "<commande> | <commande> ... : connecte la sortie de chaque commande a l'entree de la suivante\n"
+#define USAGE_EXIT    "exit : sort du shell (meme comportement que la commande exit de bash)\n"
+#define USAGE_HELP    "help : affiche la liste des commandes disponibles\n"
+
+// L'entree de la commande executee est la sortie de la precedente
+static bool input_piped = false;
 
 int get_nb_args(char* str);
 void print_help();
+void usage_error(char *usage);
+void run_command(char *command);
+void run_pipeline(char *line);
+void execute(int nb_args, char (*tab_args)[BUFFER_SIZE]);
+char* trim(char *str);
+bool contains(char *str, char *pattern);
 
 //////////////////////////////////////////////////////////////////////////////////////////
 void main()
@@ -27,167 +58,490 @@ void main()
         // Lecture des entrees
         gets(bufferInput, BUFFER_SIZE);
 
-        // Split des argments entre
-        int nb_args = get_nb_args(bufferInput);
-        char tab_args[nb_args][BUFFER_SIZE];
-        split(bufferInput, ' ', (char*)tab_args, nb_args, BUFFER_SIZE);
+        bool pipeline = false;
+        for (int i = 0; bufferInput[i] != '\0'; i++)
+        {
+            pipeline = pipeline || bufferInput[i] == '|';
+        }
+
+        if (pipeline)
+        {
+            run_pipeline(bufferInput);
+        }
+        else
+        {
+            run_command(bufferInput);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void run_command(char *command)
+{
+    // Split des argments entre
+    int nb_args = get_nb_args(command);
+    char (*tab_args)[BUFFER_SIZE] = malloc(nb_args * BUFFER_SIZE);
+    if (tab_args == NULL)
+    {
+        puts("Erreur : memoire insuffisante\n");
+        return;
+    }
+    split(command, ' ', (char*)tab_args, nb_args, BUFFER_SIZE);
+
+    execute(nb_args, tab_args);
+    free(tab_args);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void run_pipeline(char *line)
+{
+    // Chaque commande est executee par une copie du shell, sa sortie est connectee par un
+    // tube a l'entree de la suivante. Le shell tient le tube jusqu'a ce que la commande
+    // suivante soit lancee : elle ne voit pas la fin des donnees avant
+    int pids[MAX_COMMANDS];
+    int nb_commands = 0;
+    int input = PIPE_CONSOLE;
+    char *command = line;
+    while (command != NULL)
+    {
+        char *next = command;
+        while (*next != '\0' && *next != '|')
+        {
+            next++;
+        }
+        if (*next == '|')
+        {
+            *next++ = '\0';
+        }
+        else
+        {
+            next = NULL;
+        }
+
+        int output = PIPE_CONSOLE;
+        if (next != NULL && nb_commands < MAX_COMMANDS - 1 && (output = pipe_create()) == -1)
+        {
+            puts("Erreur : plus de tube disponible\n");
+            break;
+        }
+        if (next != NULL && nb_commands == MAX_COMMANDS - 1)
+        {
+            printf("Erreur : un pipeline a au plus %d commandes\n", MAX_COMMANDS);
+            break;
+        }
 
-        // ls command
-        if (strcmp(tab_args[0], "ls"))
+        int pid = fork();
+        if (pid == 0)
+        {
+            pipe_redirect(input, false);
+            pipe_redirect(output, true);
+            input_piped = input != PIPE_CONSOLE;
+            run_command(trim(command));
+            exit();
+        }
+        if (input != PIPE_CONSOLE)
         {
-            if (nb_args != 1)
+            pipe_close(input);
+        }
+        input = output;
+        if (pid == -1)
+        {
+            puts("Erreur : Le nombre maximum de tache en cours est ateint\n");
+            break;
+        }
+        pids[nb_commands++] = pid;
+        command = next;
+    }
+    if (input != PIPE_CONSOLE)
+    {
+        pipe_close(input);
+    }
+
+    // Les commandes bloquees sur un tube sont relancees jusqu'a ce qu'elles se terminent
+    bool waiting = true;
+    while (waiting)
+    {
+        waiting = false;
+        for (int i = 0; i < nb_commands; i++)
+        {
+            if (pids[i] != 0 && wait(pids[i]) != 1)
             {
-                puts("Erreur d'arguments\n");
-                puts("ls : liste tous les fichiers du systeme de fichiers\n");
+                pids[i] = 0;
             }
-            else
+            waiting = waiting || pids[i] != 0;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void execute(int nb_args, char (*tab_args)[BUFFER_SIZE])
+{
+    // ls command
+    if (strcmp(tab_args[0], "ls"))
+    {
+        if (nb_args != 1)
+        {
+            usage_error(USAGE_LS);
+        }
+        else
+        {
+            file_iterator_t it = get_file_iterator();
+            stat_t stat;
+            char name [33];
+            while (get_next_file(name, &it))
             {
-                file_iterator_t it = get_file_iterator();
-                stat_t stat;
-                char name [33];
-                while (get_next_file(name, &it))
-                {
-                    get_stat(name, &stat);
-                    printf("%s\t%d [Bytes]\n", name, stat.size);
-                }
+                get_stat(name, &stat);
+                printf("%s\t%d [Bytes]\n", name, stat.size);
             }
-            continue;
         }
+        return;
+    }
 
-        // cat command
-        if (strcmp(tab_args[0], "cat"))
+    // cat command
+    if (strcmp(tab_args[0], "cat"))
+    {
+        if (nb_args != 2)
+        {
+            usage_error(USAGE_CAT);
+        }
+        else
         {
-            if (nb_args != 2)
+            stat_t st;
+            if (get_stat(tab_args[1], &st) == -1)
             {
-                puts("Erreur d'arguments\n");
-                puts("cat <file> : affiche le contenu du fichier file\n");
+                printf("Le fichier %s n'existe pas\n", tab_args[1]);
             }
             else
             {
-                stat_t st;
-                if (get_stat(tab_args[1], &st) == -1)
+                char *data = malloc(st.size + 1);
+                if (data == NULL)
                 {
-                    printf("Le fichier %s n'existe pas\n", tab_args[1]);
+                    puts("Erreur : memoire insuffisante\n");
                 }
                 else
                 {
-                    char data[st.size];
                     read_file(tab_args[1], (uint8_t*)data);
+                    data[st.size] = '\0';
                     puts(data);
                     puts("\n");
+                    free(data);
                 }
             }
-            continue;
         }
+        return;
+    }
 
-        // rm command
-        if (strcmp(tab_args[0], "rm"))
+    // rm command
+    if (strcmp(tab_args[0], "rm"))
+    {
+        if(nb_args != 2)
         {
-            if(nb_args != 2)
-            {
-                puts("Erreur d'arguments\n");
-                puts("rm <file> : efface le fichier file\n");
-            }
-            else
+            usage_error(USAGE_RM);
+        }
+        else
+        {
+            if(remove_file(tab_args[1]) == -1)
             {
-                if(remove_file(tab_args[1]) == -1)
-                {
-                    printf("Le fichier %s n'existe pas\n", tab_args[1]);
-                }
+                printf("Le fichier %s n'existe pas\n", tab_args[1]);
             }
-            continue;
         }
+        return;
+    }
 
-        // run command
-        if (strcmp(tab_args[0], "run"))
+    // run command
+    if (strcmp(tab_args[0], "run"))
+    {
+        if(nb_args != 2)
         {
-            if(nb_args != 2)
-            {
-                puts("Erreur d'arguments\n");
-                puts("run <file> : execute le fichier file\n");
-            }
-            else
+            usage_error(USAGE_RUN);
+        }
+        else
+        {
+            switch (exec(tab_args[1]))
             {
-                switch (exec(tab_args[1]))
-                {
-                case -1:
-                    puts("Erreur : Le nombre maximum de tache en cours est ateint\n");
-                    break;
-                case -2:
-                    printf("Erreur : Le fichier %s n'existe pas\n", tab_args[1]);
-                    break;
-                default:
-                    break;
-                }
+            case -1:
+                puts("Erreur : Le nombre maximum de tache en cours est ateint\n");
+                break;
+            case -2:
+                printf("Erreur : Le fichier %s n'existe pas\n", tab_args[1]);
+                break;
+            default:
+                break;
             }
-            continue;
         }
+        return;
+    }
 
-        // ticks command
-        if (strcmp(tab_args[0], "ticks"))
+    // fork command
+    if (strcmp(tab_args[0], "fork"))
+    {
+        if (nb_args != 1)
         {
-            if(nb_args != 1)
+            usage_error(USAGE_FORK);
+        }
+        else
+        {
+            int child = fork();
+            if (child == -1)
             {
-                puts("Erreur d'arguments\n");
-                puts("ticks : affiche le nombre de ticks courant\n");
+                puts("Erreur : Le nombre maximum de tache en cours est ateint\n");
             }
-            else
+            else if (child > 0)
             {
-                printf("%d\n", get_ticks());
+                printf("Le shell %d est termine\n", child);
             }
-            continue;
         }
+        return;
+    }
 
-        // sleep command
-        if (strcmp(tab_args[0], "sleep"))
+    // ticks command
+    if (strcmp(tab_args[0], "ticks"))
+    {
+        if(nb_args != 1)
         {
-            if(nb_args != 2)
-            {
-                puts("Erreur d'arguments\n");
-                puts("sleep <N> : attend pendant N milli-secondes\n");
-            }
-            else
-            {
-                sleep(atoi(tab_args[1]));
-            }
-            continue;
+            usage_error(USAGE_TICKS);
+        }
+        else
+        {
+            printf("%d\n", get_ticks());
+        }
+        return;
+    }
+
+    // sleep command
+    if (strcmp(tab_args[0], "sleep"))
+    {
+        if(nb_args != 2)
+        {
+            usage_error(USAGE_SLEEP);
+        }
+        else
+        {
+            sleep(atoi(tab_args[1]));
         }
+        return;
+    }
+
+    // prof command
+    if (strcmp(tab_args[0], "prof"))
+    {
+        if (nb_args != 2)
+        {
+            usage_error(USAGE_PROF);
+        }
+        else if (strcmp(tab_args[1], "start"))
+        {
+            profiler(PROFILER_START);
+        }
+        else if (strcmp(tab_args[1], "stop"))
+        {
+            profiler(PROFILER_STOP);
+        }
+        else if (strcmp(tab_args[1], "reset"))
+        {
+            profiler(PROFILER_RESET);
+        }
+        else if (strcmp(tab_args[1], "dump"))
+        {
+            profiler(PROFILER_DUMP);
+        }
+        else
+        {
+            printf("Commande prof inconnue : %s\n", tab_args[1]);
+        }
+        return;
+    }
+
+    // trace command
+    if (strcmp(tab_args[0], "trace"))
+    {
+        if (nb_args != 1)
+        {
+            usage_error(USAGE_TRACE);
+        }
+        else if (trace_dump() == -1)
+        {
+            puts("Erreur : le noyau n'a pas ete compile avec TRACE=1\n");
+        }
+        return;
+    }
+
+    // mem command
+    if (strcmp(tab_args[0], "mem"))
+    {
+        if (nb_args != 1)
+        {
+            usage_error(USAGE_MEM);
+        }
+        else
+        {
+            mem_stats();
+        }
+        return;
+    }
+
+    // locks command
+    if (strcmp(tab_args[0], "locks"))
+    {
+        if (nb_args > 2 || (nb_args == 2 && !strcmp(tab_args[1], "reset")))
+        {
+            usage_error(USAGE_LOCKS);
+        }
+        else
+        {
+            lock_stats(nb_args == 2);
+        }
+        return;
+    }
+
+    // irq command
+    if (strcmp(tab_args[0], "irq"))
+    {
+        if (nb_args != 1)
+        {
+            usage_error(USAGE_IRQ);
+        }
+        else
+        {
+            irq_stats();
+        }
+        return;
+    }
+
+    // latency command
+    if (strcmp(tab_args[0], "latency"))
+    {
+        if (nb_args > 2 || (nb_args == 2 && !strcmp(tab_args[1], "reset")))
+        {
+            usage_error(USAGE_LATENCY);
+        }
+        else if (latency_stats(nb_args == 2) == -1)
+        {
+            puts("Erreur : le noyau n'a pas ete compile avec LATENCY=1\n");
+        }
+        return;
+    }
 
-        // exit command
-        if (strcmp(tab_args[0], "exit"))
+    // heap command
+    if (strcmp(tab_args[0], "heap"))
+    {
+        if (nb_args != 1)
+        {
+            usage_error(USAGE_HEAP);
+        }
+        else
         {
-            if(nb_args != 1)
+            malloc_stats_t heap;
+            malloc_get_stats(&heap);
+            printf("tas : %u octets, %u alloues, %u utilises, %u fragmentes, %u libres\n",
+                   heap.heap_size, heap.allocated, heap.used, heap.used - heap.allocated, heap.free);
+            printf("malloc : %u, free : %u, echecs : %u\n",
+                   heap.nb_mallocs, heap.nb_frees, heap.nb_failures);
+        }
+        return;
+    }
+
+    // wc command
+    if (strcmp(tab_args[0], "wc"))
+    {
+        if (nb_args != 1 || !input_piped)
+        {
+            usage_error(USAGE_WC);
+        }
+        else
+        {
+            // Lue par blocs, sans attendre la fin de la commande
+            char data[BUFFER_SIZE];
+            uint nb_lines = 0, nb_words = 0, nb_bytes = 0;
+            bool in_word = false;
+            int count;
+            while ((count = read(data, sizeof(data))) > 0)
             {
-                puts("Erreur d'arguments\n");
-                puts("exit : sort du shell (meme comportement que la commande exit de bash)\n");
+                nb_bytes += count;
+                for (int i = 0; i < count; i++)
+                {
+                    if (data[i] == '\n')
+                    {
+                        nb_lines++;
+                    }
+                    bool space = data[i] == ' ' || data[i] == '\t' || data[i] == '\n';
+                    if (!space && !in_word)
+                    {
+                        nb_words++;
+                    }
+                    in_word = !space;
+                }
             }
-            else
+            printf("%u %u %u\n", nb_lines, nb_words, nb_bytes);
+        }
+        return;
+    }
+
+    // grep command
+    if (strcmp(tab_args[0], "grep"))
+    {
+        if (nb_args != 2 || !input_piped)
+        {
+            usage_error(USAGE_GREP);
+        }
+        else
+        {
+            char line[BUFFER_SIZE];
+            while (read_line(line, BUFFER_SIZE) != -1)
             {
-                exit();
+                if (contains(line, tab_args[1]))
+                {
+                    printf("%s\n", line);
+                }
             }
-            continue;
         }
+        return;
+    }
 
-        // help command
-        if (strcmp(tab_args[0], "help"))
+    // exit command
+    if (strcmp(tab_args[0], "exit"))
+    {
+        if(nb_args != 1)
         {
-            print_help();
-            continue;
+            usage_error(USAGE_EXIT);
         }
+        else
+        {
+            exit();
+        }
+        return;
+    }
+
+    // help command
+    if (strcmp(tab_args[0], "help"))
+    {
+        print_help();
+        return;
     }
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 void print_help()
 {
-    puts("ls : liste tous les fichiers du systeme de fichiers\n");
-    puts("cat <file> : affiche le contenu du fichier file\n");
-    puts("rm <file> : efface le fichier file\n");
-    puts("run <file> : execute le fichier file\n");
-    puts("ticks : affiche le nombre de ticks courant\n");
-    puts("sleep <N> : attend pendant N milli-secondes\n");
-    puts("exit : sort du shell (meme comportement que la commande exit de bash)\n");
-    puts("help : affiche la liste des commandes disponibles\n");
+    puts(USAGE_LS);
+    puts(USAGE_CAT);
+    puts(USAGE_RM);
+    puts(USAGE_RUN);
+    puts(USAGE_FORK);
+    puts(USAGE_TICKS);
+    puts(USAGE_SLEEP);
+    puts(USAGE_PROF);
+    puts(USAGE_TRACE);
+    puts(USAGE_MEM);
+    puts(USAGE_LOCKS);
+    puts(USAGE_IRQ);
+    puts(USAGE_LATENCY);
+    puts(USAGE_HEAP);
+    puts(USAGE_WC);
+    puts(USAGE_GREP);
+    puts(USAGE_PIPE);
+    puts(USAGE_EXIT);
+    puts(USAGE_HELP);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -215,3 +569,39 @@ int get_nb_args(char* args)
     }
     return nb_args;
 }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+char* trim(char *str)
+{
+    while (*str == ' ')
+    {
+        str++;
+    }
+    int length = strlen(str);
+    while (length > 0 && str[length - 1] == ' ')
+    {
+        str[--length] = '\0';
+    }
+    return str;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+bool contains(char *str, char *pattern)
+{
+    int length = strlen(pattern);
+    for (int i = 0; str[i] != '\0'; i++)
+    {
+        if (strncmp(&str[i], pattern, length) == 0)
+        {
+            return true;
+        }
+    }
+    return length == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void usage_error(char *usage)
+{
+    puts("Erreur d'arguments\n");
+    puts(usage);
+}
@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \file shmbench.c
+/// \brief Benchmark of the shared memory regions.
+///
+/// A producer and a forked consumer exchange blocks of data, first through a shared
+/// memory region mapped by both tasks: the producer writes each block in place and the
+/// consumer, called through a port, reads it in place. The same blocks then go through
+/// a pipe, which copies them into the kernel and out again. The results are printed as
+/// "BENCH <name> <iterations> <cycles/op>" lines, like the kernel benchmarks, with the
+/// throughput of each way.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ulibc.h"
+
+#define ITERATIONS      100
+#define PAGE_SIZE       4096
+#define BLOCK_SIZE      (64 * 1024)
+#define BLOCK_WORDS     (BLOCK_SIZE / sizeof(uint))
+
+// Where the region is mapped by the producer and by the consumer, after the executable
+static uint shared[BLOCK_WORDS] __attribute__((aligned(PAGE_SIZE)));
+static uint window[BLOCK_WORDS] __attribute__((aligned(PAGE_SIZE)));
+
+// Block written to the pipe or read from it
+static uint block[BLOCK_WORDS];
+
+// Low 32 bits of the time stamp counter, enough for the durations measured here.
+static uint cycles()
+{
+    uint low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return low;
+}
+
+// Fills the block of an iteration.
+static void fill(uint *data, uint iteration)
+{
+    for (uint i = 0; i < BLOCK_WORDS; i++)
+    {
+        data[i] = i + iteration;
+    }
+}
+
+// Returns the sum of the words of a block, which the consumer checks.
+static uint checksum(uint *data)
+{
+    uint sum = 0;
+    for (uint i = 0; i < BLOCK_WORDS; i++)
+    {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// Sum of the block of an iteration.
+static uint expected_checksum(uint iteration)
+{
+    return BLOCK_WORDS * (BLOCK_WORDS - 1) / 2 + BLOCK_WORDS * iteration;
+}
+
+// Maps the region at window and replies to each message with the sum of the block
+// there. Runs until the producer exits.
+static void shm_consumer(int region, int port)
+{
+    if (shm_map(region, window) != BLOCK_SIZE)
+    {
+        printf("# shmbench: shm_map failed\n");
+        return;
+    }
+
+    ipc_msg_t msg;
+    while (1)
+    {
+        msg.pages = 0;
+        if (port_receive(port, &msg) == -1)
+        {
+            return;
+        }
+        msg.data[1] = checksum(window);
+        port_reply(port, &msg);
+    }
+}
+
+// Reads the blocks from the input until the end of the pipe and checks them.
+static void pipe_consumer()
+{
+    uint nb_blocks = 0, nb_errors = 0, size = 0;
+    int count;
+    while ((count = read((uint8_t*)block + size, BLOCK_SIZE - size)) > 0)
+    {
+        size += count;
+        if (size == BLOCK_SIZE)
+        {
+            if (checksum(block) != expected_checksum(nb_blocks))
+            {
+                nb_errors++;
+            }
+            nb_blocks++;
+            size = 0;
+        }
+    }
+
+    if (nb_blocks != ITERATIONS || nb_errors != 0)
+    {
+        printf("# shmbench: %u blocks out of %u read from the pipe, %u wrong\n",
+               nb_blocks, ITERATIONS, nb_errors);
+    }
+}
+
+// Prints the result of a way of passing the blocks.
+static void print_result(char *name, uint total, uint khz)
+{
+    uint per_block = total / ITERATIONS;
+    uint size_kb = BLOCK_SIZE / 1024;
+    printf("BENCH %s_%uk %u %u\n", name, size_kb, ITERATIONS, per_block);
+
+    // KB per millisecond, about MB/s
+    printf("# %s_%uk: %u MB/s\n", name, size_kb, per_block != 0 ? size_kb * khz / per_block : 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void main()
+{
+    uint khz = get_tsc_khz();
+
+    int region = shm_create(BLOCK_SIZE);
+    int port = port_create();
+    if (region == -1 || port == -1)
+    {
+        printf("# shmbench: no free region or port\n");
+        return;
+    }
+
+    // The consumer maps the region and waits for the first message, fork() returns then
+    int pid = fork();
+    if (pid == 0)
+    {
+        shm_consumer(region, port);
+        exit();
+    }
+    if (pid == -1 || shm_map(region, shared) != BLOCK_SIZE)
+    {
+        printf("# shmbench: fork or shm_map failed\n");
+        return;
+    }
+
+    ipc_msg_t msg;
+    uint start = cycles();
+    for (uint j = 0; j < ITERATIONS; j++)
+    {
+        fill(shared, j);
+        msg.data[0] = j;
+        msg.pages = 0;
+        if (port_send(port, &msg) == -1 || msg.data[1] != expected_checksum(j))
+        {
+            printf("# shmbench: wrong block read from the region\n");
+            return;
+        }
+    }
+    print_result("shm", cycles() - start, khz);
+
+    // The consumer reads the pipe until the producer closes it
+    int pipe = pipe_create();
+    if (pipe == -1)
+    {
+        printf("# shmbench: no free pipe\n");
+        return;
+    }
+    pid = fork();
+    if (pid == 0)
+    {
+        pipe_redirect(pipe, false);
+        pipe_consumer();
+        exit();
+    }
+    if (pid == -1)
+    {
+        printf("# shmbench: fork failed\n");
+        return;
+    }
+
+    start = cycles();
+    pipe_redirect(pipe, true);
+    for (uint j = 0; j < ITERATIONS; j++)
+    {
+        fill(block, j);
+        write(block, BLOCK_SIZE);
+    }
+    pipe_redirect(PIPE_CONSOLE, true);
+    pipe_close(pipe);
+    while (wait(pid) == 1)
+    {
+    }
+    print_result("pipe", cycles() - start, khz);
+}
@@ -1,4 +1,5 @@
 global syscall
+global ipc_syscall
 
 section .text                      ; start of the text (code) section
 align 4                            ; the code must be 4 byte aligned
@@ -39,3 +40,34 @@ syscall:
     pop     ebp
     ret
 
+
+; int ipc_syscall(uint32_t nb, uint32_t port, ipc_msg_t *msg);
+; The message goes in ecx, edx and esi, the kernel returns the message received or the
+; reply there. edi keeps the address of the message: the kernel saves it.
+ipc_syscall:
+    push    ebp
+    mov     ebp,esp
+
+    push    ebx
+    push    esi
+    push    edi
+
+    mov     eax,[ebp+8]
+    mov     ebx,[ebp+12]
+    mov     edi,[ebp+16]
+    mov     ecx,[edi]
+    mov     edx,[edi+4]
+    mov     esi,[edi+8]
+    int     48
+
+    mov     [edi],ecx
+    mov     [edi+4],edx
+    mov     [edi+8],esi
+
+    pop     edi
+    pop     esi
+    pop     ebx
+
+    mov     esp,ebp
+    pop     ebp
+    ret
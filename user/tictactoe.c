@@ -207,7 +207,13 @@ void printScreen(char* fileName)
     clear_display();
     set_cursor(0, 0);
     get_stat(fileName, &st);
-    char data[st.size];
+    char *data = malloc(st.size + 1);
+    if (data == NULL)
+    {
+        return;
+    }
     read_file(fileName, (uint8_t*)data);
+    data[st.size] = '\0';
     puts(data);
+    free(data);
 }
@@ -12,6 +12,7 @@
 #include "../common/common_io.h"
 
 extern int syscall(uint32_t nb, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
+extern int ipc_syscall(uint32_t nb, uint32_t port, ipc_msg_t *msg);
 
 //////////////////////////////////////////////////////////////////////////////////////////
 int read_file(char *filename, uchar *buf)
@@ -51,56 +52,73 @@ int exec(char *filename)
 	return syscall(SYSCALL_EXEC, (uint32_t) filename, 0, 0, 0);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+int fork()
+{
+	return syscall(SYSCALL_FORK, 0, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int wait(int pid)
+{
+	return syscall(SYSCALL_WAIT, (uint32_t) pid, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int brk(void *addr)
+{
+	return syscall(SYSCALL_BRK, (uint32_t) addr, 0, 0, 0) == -1 ? -1 : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+void* sbrk(int increment)
+{
+	extern char _end[];		// End of the bss, defined in app.ld
+
+	// The heap starts after the bss, the kernel reads it in the header of the program or
+	// learns it at the first call
+	int current = syscall(SYSCALL_BRK, 0, 0, 0, 0);
+	if (current == 0)
+	{
+		current = syscall(SYSCALL_BRK, (uint32_t) _end, 0, 0, 0);
+	}
+
+	if (current == -1 || (increment != 0 && syscall(SYSCALL_BRK, current + increment, 0, 0, 0) == -1))
+	{
+		return (void*) -1;
+	}
+	return (void*) current;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 int getc()
 {
 	return syscall(SYSCALL_GETC, 0, 0, 0, 0);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+int read_line(char *buffer, unsigned int bufferSize)
+{
+	// The line is edited and echoed by the kernel, in a single system call
+	return syscall(SYSCALL_READ_LINE, (uint32_t) buffer, bufferSize, 0, 0);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 unsigned int gets(char *buffer, unsigned int bufferSize)
 {
-	char input;
-    unsigned int bufferCursor = 0;
-
-	// Wait for a character input while the buffer isn't full and RETURN isn't pressed
-    while (bufferCursor < bufferSize - 1 && (input = getc()) != '\n')
-    {
-		// Ignore tab character and
-        if (input == '\t')
-        {
-            continue;
-        }
-
-		// If backspace is pressed
-        if (input == '\b')
-        {
-			// Don't remove character if none was entered
-			if (bufferCursor == 0)
-			{
-				continue;
-			}
-			else
-			{
-	            bufferCursor--;
-			}
-        }
-        else
-        {
-        	buffer[bufferCursor++] = input;
-        }
-
-		putc(input);
-    }
-
-	// Print the new line
-	putc('\n');
-
-	// Add the end of string character
-    buffer[bufferCursor] = 0;
-
-	// Return the number of entered characters
-	return bufferCursor;
+	return read_line(buffer, bufferSize);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int read(void *buffer, unsigned int size)
+{
+	return syscall(SYSCALL_READ, (uint32_t) buffer, size, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int write(void *buffer, unsigned int size)
+{
+	return syscall(SYSCALL_WRITE, (uint32_t) buffer, size, 0, 0);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -139,8 +157,104 @@ void sleep(uint ms)
 	syscall(SYSCALL_SLEEP, (uint32_t) ms, 0, 0, 0);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+int port_create()
+{
+	return syscall(SYSCALL_PORT_CREATE, 0, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int port_send(int port, ipc_msg_t *msg)
+{
+	return ipc_syscall(SYSCALL_PORT_SEND, (uint32_t) port, msg);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int port_receive(int port, ipc_msg_t *msg)
+{
+	return ipc_syscall(SYSCALL_PORT_RECEIVE, (uint32_t) port, msg);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int port_reply(int port, ipc_msg_t *msg)
+{
+	return ipc_syscall(SYSCALL_PORT_REPLY, (uint32_t) port, msg);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_create()
+{
+	return syscall(SYSCALL_PIPE_CREATE, 0, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_close(int pipe)
+{
+	return syscall(SYSCALL_PIPE_CLOSE, (uint32_t) pipe, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int pipe_redirect(int pipe, bool output)
+{
+	return syscall(SYSCALL_PIPE_REDIRECT, (uint32_t) pipe, (uint32_t) output, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int shm_create(uint size)
+{
+	return syscall(SYSCALL_SHM_CREATE, size, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int shm_map(int region, void *address)
+{
+	return syscall(SYSCALL_SHM_MAP, (uint32_t) region, (uint32_t) address, 0, 0);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 uint get_ticks()
 {
 	return syscall(SYSCALL_GET_TICKS, 0, 0, 0, 0);
 }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+uint get_tsc_khz()
+{
+	return syscall(SYSCALL_GET_TSC_KHZ, 0, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int profiler(profiler_cmd_t cmd)
+{
+	return syscall(SYSCALL_PROFILER, (uint32_t) cmd, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int trace_dump()
+{
+	return syscall(SYSCALL_TRACE_DUMP, 0, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int mem_stats()
+{
+	return syscall(SYSCALL_MEM_STATS, 0, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int irq_stats()
+{
+	return syscall(SYSCALL_IRQ_STATS, 0, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int lock_stats(bool reset)
+{
+	return syscall(SYSCALL_LOCK_STATS, reset, 0, 0, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+int latency_stats(bool reset)
+{
+	return syscall(SYSCALL_LATENCY_STATS, reset, 0, 0, 0);
+}
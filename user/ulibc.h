@@ -11,6 +11,7 @@
 
 #include "../common/types.h"
 #include "../common/string.h"
+#include "../common/syscall_nb.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 /// \struct __attribute__((packed)) file_iterator_t
@@ -41,6 +42,35 @@ typedef struct __attribute__((packed))
     uint32_t size;
 } stat_t;
 
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct malloc_stats_t
+/// \brief Counters of the heap allocator (malloc/free).
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    uint32_t heap_size;     ///< Bytes obtained from the kernel with sbrk()
+    uint32_t allocated;     ///< Bytes requested by the live allocations
+    uint32_t used;          ///< Bytes of the live blocks, headers and rounding included
+    uint32_t free;          ///< Bytes of the freed blocks kept for reuse
+    uint32_t nb_mallocs;
+    uint32_t nb_frees;
+    uint32_t nb_failures;   ///< Allocations that couldn't grow the heap
+} malloc_stats_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// \struct ipc_msg_t
+/// \brief Message of a port, passed in registers.
+///
+/// pages gives the pages lent with the message (IPC_PAGES(address, count), see
+/// syscall_nb.h): they are unmapped from the task and mapped in the receiver, without
+/// copy. The reply brings them back at the same address.
+//////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    uint32_t data[2];
+    uint32_t pages;
+} ipc_msg_t;
+
 // Fonctions d'accès aux fichiers
 extern int read_file(char *filename, uchar *buf);
 extern int get_stat(char *filename, stat_t *stat);
@@ -50,19 +80,51 @@ extern int get_next_file(char *filename, file_iterator_t *it);
 
 // Fonctions de contrôle de processus (tâche) :
 extern int exec(char *filename);
+extern int fork();
 extern void exit();
+extern int wait(int pid);     // Relance l'enfant bloque (tube, attente) : 1 s'il attend encore
+
+// Fonctions de communication entre tâches (ports, tubes et memoire partagee) :
+extern int port_create();
+extern int port_send(int port, ipc_msg_t *msg);      // Attend la reponse, qui remplace msg
+extern int port_receive(int port, ipc_msg_t *msg);   // msg->pages : fenetre de reception
+extern int port_reply(int port, ipc_msg_t *msg);
+extern int pipe_create();
+extern int pipe_close(int pipe);
+extern int pipe_redirect(int pipe, bool output);     // pipe : PIPE_CONSOLE pour la console
+extern int shm_create(uint size);                   // Region detruite a la fin de la tache
+extern int shm_map(int region, void *address);      // Retourne la taille de la region
+
+// Fonctions de gestion de la mémoire :
+extern int brk(void *addr);
+extern void* sbrk(int increment);
+extern void* malloc(uint32_t size);
+extern void free(void *ptr);
+extern void malloc_get_stats(malloc_stats_t *stats);
 
 // Fonctions d'entrées/sorties :
-extern int getc();
+extern int getc();      // Mode brut : ni echo, ni edition. -1 a la fin d'un tube
+extern int read_line(char *buffer, unsigned int bufferSize);    // -1 a la fin d'un tube
 extern unsigned int gets(char *buffer, unsigned int bufferSize);
+extern int read(void *buffer, unsigned int size);   // 0 a la fin d'un tube
+extern int write(void *buffer, unsigned int size);
 extern void putc(char c);
 extern void puts(char *str);
 extern void printf(char *frmt, ...);
 extern void clear_display();
 extern void set_cursor(int ligne, int colonne);
 
+// Fonctions de profilage :
+extern int profiler(profiler_cmd_t cmd);
+extern int trace_dump();
+extern int mem_stats();
+extern int lock_stats(bool reset);
+extern int irq_stats();
+extern int latency_stats(bool reset);   // -1 sans LATENCY=1
+
 // Fonctions liées au temps :
 extern void sleep(uint ms);
 extern uint get_ticks();
+extern uint get_tsc_khz();
 
 #endif